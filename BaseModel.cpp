@@ -3,9 +3,19 @@
 //
 
 #include "BaseModel.h"
-
+#include "EarlySplit.h"
+#include "MeshCleanup.h"
+#include "MeshSimplifier.h"
+#include "PLOCBuilder.h"
+#include "Refit.h"
+#include "SpatialSplitBuilder.h"
+#include "TreeOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <limits>
 
 void splitSlash(const std::string& s, std::string tokens[3]) {
     std::string token;
@@ -117,12 +127,18 @@ float nodeCost(const glm::vec4 min, const glm::vec4 max) {
 BaseModel::BaseModel() = default;
 
 void BaseModel::parse(const std::string& nfilename, std::vector<glm::vec3>& vertices, std::vector<glm::ivec3>& triangles) {
-    const std::string filename = "" + nfilename;
+    const std::vector<char> buffer = readFile(nfilename);
+    if (buffer.empty()) return;
+
+    parse(buffer, vertices, triangles);
+}
+
+std::vector<char> BaseModel::readFile(const std::string& filename) {
     std::ifstream model(filename, std::ios::binary | std::ios::ate);
 
     if (!model.is_open()) {
         std::cerr << "Failed to open file: " << filename << std::endl;
-        return;
+        return {};
     }
 
     std::streamsize size = model.tellg();
@@ -131,9 +147,12 @@ void BaseModel::parse(const std::string& nfilename, std::vector<glm::vec3>& vert
     model.read(buffer.data(), size);
 
     buffer[size] = '\0';  // Null-terminate for safe parsing
+    return buffer;
+}
 
-    char* ptr = buffer.data();
-    char* end = ptr + size;
+void BaseModel::parse(const std::vector<char>& buffer, std::vector<glm::vec3>& vertices, std::vector<glm::ivec3>& triangles) {
+    const char* ptr = buffer.data();
+    const char* end = ptr + buffer.size() - 1;
     std::string start;
     bool prefix;
 
@@ -209,13 +228,17 @@ void BaseModel::parse(const std::string& nfilename, std::vector<glm::vec3>& vert
     center(vertices);
 }
 
-BaseModel::BaseModel(const std::string &filename) {
+BaseModel::BaseModel(const std::string &filename, const BuildOptions& options) {
     this->filename = filename;
     std::vector<glm::vec3> tempVertices;
     std::vector<glm::ivec3> tempTriangles;
 
     parse(filename, tempVertices, tempTriangles);
 
+    build(tempVertices, tempTriangles, options);
+}
+
+void BaseModel::build(const std::vector<glm::vec3>& tempVertices, const std::vector<glm::ivec3>& tempTriangles, const BuildOptions& options) {
     std::cout << filename << std::endl;
     std::cout << tempVertices.size() << std::endl;
     std::cout << tempTriangles.size()/3 << std::endl;
@@ -229,8 +252,186 @@ BaseModel::BaseModel(const std::string &filename) {
     for (int i = 0; i < numTris; ++i) {
         triangles.emplace_back(tempTriangles[i*3+0].x, tempTriangles[i*3+1].x, tempTriangles[i*3+2].x);
     }
+    if (options.cleanup) {
+        cleanMesh(vertices, triangles, options.weldTolerance);
+        numTris = int(triangles.size()) - triStart;
+    }
+    // simplified from the cleaned mesh, before the builders reorder or split its triangles
+    if (options.lodLevels > 0) buildLods(options);
+
+    buildTree(triStart, numTris, options);
+}
 
-    createBVH(32, 5, triStart, numTris);
+void BaseModel::buildTree(const int triStart, int numTris, const BuildOptions& options) {
+    const int depth = options.maxDepth > 0 ? options.maxDepth : std::numeric_limits<int>::max();
+    const auto buildStart = std::chrono::steady_clock::now();
+    if (options.builder == Builder::SpatialSplit) {
+        SpatialSplitBuilder(*this).build(depth, options.duplicationBudget);
+    } else if (options.builder == Builder::PLOC) {
+        PLOCBuilder(*this).build();
+    } else {
+        if (options.earlySplitBudget > 0) numTris += earlySplit(*this, options.earlySplitThreshold, options.earlySplitBudget);
+        createBVH(depth, 5, triStart, numTris);
+        std::vector<glm::vec3>().swap(referenceMin);
+        std::vector<glm::vec3>().swap(referenceMax);
+    }
+    if (!boundingBoxMin.empty()) {
+        std::cout << "BVH build: " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count()
+                  << " ms, SAH cost " << treeCost(boundingBoxMin.data(), boundingBoxMax.data(), 0) << ", depth "
+                  << treeDepth(boundingBoxMin.data(), boundingBoxMax.data(), 0) << std::endl;
+    }
+    if (options.optimizeMs > 0) TreeOptimizer(*this).optimize(options.optimizeMs);
+
+    if (options.order != NodeOrder::Build) {
+        reorderVertices();
+        reorderNodes(options.order);
+    } else if (options.optimizeMs > 0) {
+        // the optimizer reuses node slots, which can put a child before its parent;
+        // depth first is the order the builds emit and puts every child after it again
+        reorderNodes(NodeOrder::DepthFirst);
+    }
+}
+
+void BaseModel::buildLods(const BuildOptions& options) {
+    // levels under a handful of triangles would cost more in nodes than they save
+    constexpr int MIN_LOD_TRIANGLES = 16;
+    std::vector<int> targets;
+    float target = float(triangles.size());
+    for (int level = 0; level < options.lodLevels; ++level) {
+        target *= options.lodRatio;
+        if (target < MIN_LOD_TRIANGLES) break;
+        targets.push_back(int(target));
+    }
+    if (targets.empty()) return;
+
+    BuildOptions levelOptions = options;
+    levelOptions.lodLevels = 0;
+    levelOptions.cleanup = false;
+    std::vector<SimplifiedMesh> meshes = simplifyMesh(vertices, triangles, targets);
+    lods.resize(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        BaseModel& lod = lods[i];
+        lod.filename = filename + " LOD " + std::to_string(i + 1);
+        lod.vertices = std::move(meshes[i].vertices);
+        lod.triangles = std::move(meshes[i].triangles);
+        lod.lodError = meshes[i].error;
+        lod.buildTree(0, int(lod.triangles.size()), levelOptions);
+    }
+}
+
+void BaseModel::reorderVertices() {
+    std::vector<int> remap(vertices.size(), -1);
+    std::vector<glm::vec3> ordered;
+    ordered.reserve(vertices.size());
+    for (glm::ivec3& triangle : triangles) {
+        for (int k = 0; k < 3; ++k) {
+            int& index = triangle[k];
+            if (remap[index] < 0) {
+                remap[index] = int(ordered.size());
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+    }
+    vertices = std::move(ordered);
+}
+
+// Children of one node are always stored as an adjacent pair, so layouts are
+// built over pairs: the pair of node n holds n's two children. Trees can be
+// hundreds of levels deep, so these walk explicit stacks rather than recursing.
+void pairsPreorder(const std::vector<glm::vec4>& bboxMin, const std::vector<glm::vec4>& bboxMax, const int root, std::vector<int>& order) {
+    std::vector<int> stack = {root};
+    while (!stack.empty()) {
+        const int node = stack.back();
+        stack.pop_back();
+        if (bboxMin[node].w <= 0) continue;
+        order.push_back(node);
+        stack.push_back(int(bboxMax[node].w));
+        stack.push_back(int(bboxMin[node].w));
+    }
+}
+
+// Lays out the top height levels of pairs below root, then each pair just below
+// them the same way with the levels left, splitting every height in half. A
+// frame's middle collects the pairs below its top half; owner is the frame whose
+// middle its own frontier goes to, -1 for the caller's frontier.
+void pairsVanEmdeBoas(const std::vector<glm::vec4>& bboxMin, const std::vector<glm::vec4>& bboxMax, const int root, const int rootHeight,
+                      std::vector<int>& order, std::vector<int>& frontier) {
+    struct Frame {
+        int node, height, owner;
+        std::vector<int> middle;
+        size_t next = 0;
+        bool topDone = false;
+    };
+    std::vector<Frame> frames;
+    frames.push_back({root, rootHeight, -1});
+    while (!frames.empty()) {
+        const int current = int(frames.size()) - 1;
+        Frame& frame = frames.back();
+        if (bboxMin[frame.node].w <= 0) {
+            frames.pop_back();
+            continue;
+        }
+        if (frame.height == 1) {
+            std::vector<int>& out = frame.owner < 0 ? frontier : frames[size_t(frame.owner)].middle;
+            order.push_back(frame.node);
+            out.push_back(int(bboxMin[frame.node].w));
+            out.push_back(int(bboxMax[frame.node].w));
+            frames.pop_back();
+            continue;
+        }
+        const int top = frame.height / 2;
+        if (!frame.topDone) {
+            frame.topDone = true;
+            const int node = frame.node;
+            frames.push_back({node, top, current});
+            continue;
+        }
+        if (frame.next < frame.middle.size()) {
+            const int node = frame.middle[frame.next++];
+            const int height = frame.height - top;
+            const int owner = frame.owner;
+            frames.push_back({node, height, owner});
+            continue;
+        }
+        frames.pop_back();
+    }
+}
+
+void BaseModel::reorderNodes(const NodeOrder order) {
+    if (order == NodeOrder::Build || boundingBoxMin.empty()) return;
+
+    std::vector<int> pairs;
+    if (order == NodeOrder::DepthFirst) {
+        pairsPreorder(boundingBoxMin, boundingBoxMax, 0, pairs);
+    } else {
+        std::vector<int> frontier;
+        // pair levels are node levels less the leaves
+        pairsVanEmdeBoas(boundingBoxMin, boundingBoxMax, 0, treeDepth(boundingBoxMin.data(), boundingBoxMax.data(), 0) - 1, pairs, frontier);
+    }
+
+    // root stays at 0, the k-th pair goes to 1+2k and 2+2k
+    std::vector<int> remap(boundingBoxMin.size(), -1);
+    remap[0] = 0;
+    for (size_t k = 0; k < pairs.size(); ++k) {
+        remap[int(boundingBoxMin[pairs[k]].w)] = int(1 + 2 * k);
+        remap[int(boundingBoxMax[pairs[k]].w)] = int(2 + 2 * k);
+    }
+
+    std::vector<glm::vec4> newMin(pairs.size() * 2 + 1), newMax(pairs.size() * 2 + 1);
+    for (size_t i = 0; i < boundingBoxMin.size(); ++i) {
+        if (remap[i] < 0) continue;
+        glm::vec4 nodeMin = boundingBoxMin[i];
+        glm::vec4 nodeMax = boundingBoxMax[i];
+        if (nodeMin.w > 0) {
+            nodeMin.w = float(remap[int(nodeMin.w)]);
+            nodeMax.w = float(remap[int(nodeMax.w)]);
+        }
+        newMin[remap[i]] = nodeMin;
+        newMax[remap[i]] = nodeMax;
+    }
+    boundingBoxMin = std::move(newMin);
+    boundingBoxMax = std::move(newMax);
 }
 
 void BaseModel::createBVH(const int depth, const int numTestsPerAxis, int triStart, int numTris) {
@@ -239,13 +440,10 @@ void BaseModel::createBVH(const int depth, const int numTestsPerAxis, int triSta
     auto max = glm::vec3(-1000000000.0f);
 
     for (int i = triStart; i < triStart + numTris; ++i) {
-        glm::ivec3 tri = triangles[i];
-        glm::vec3 v1 = vertices[tri.x];
-        glm::vec3 v2 = vertices[tri.y];
-        glm::vec3 v3 = vertices[tri.z];
-        growToInclude(min, max, v1);
-        growToInclude(min, max, v2);
-        growToInclude(min, max, v3);
+        glm::vec3 lo, hi, center;
+        triangleBounds(i, lo, hi, center);
+        growToInclude(min, max, lo);
+        growToInclude(min, max, hi);
     }
 
     glm::vec4 bboxMin = glm::vec4(min, -triStart);
@@ -255,9 +453,33 @@ void BaseModel::createBVH(const int depth, const int numTestsPerAxis, int triSta
     boundingBoxMin.emplace_back(bboxMin);
     boundingBoxMax.emplace_back(bboxMax);
 
-    split(numTestsPerAxis, bboxMin, bboxMax, depth-1);
-    boundingBoxMin[index] = bboxMin;
-    boundingBoxMax[index] = bboxMax;
+    // nodes with the levels left below them, B pushed before A so A's subtree is
+    // built first and the nodes keep the order the recursive build gave them
+    std::vector<std::pair<int, int>> work = {{index, depth-1}};
+    while (!work.empty()) {
+        const auto [node, levels] = work.back();
+        work.pop_back();
+        if (levels <= 0 || !split(numTestsPerAxis, node)) continue;
+        const int childA = int(boundingBoxMin[node].w);
+        work.emplace_back(childA + 1, levels - 1);
+        work.emplace_back(childA, levels - 1);
+    }
+}
+
+void BaseModel::triangleBounds(const int i, glm::vec3& min, glm::vec3& max, glm::vec3& center) const {
+    if (!referenceMin.empty()) {
+        min = referenceMin[i];
+        max = referenceMax[i];
+        center = (min + max) * 0.5f;
+        return;
+    }
+    const glm::ivec3 tri = triangles[i];
+    const glm::vec3 v1 = vertices[tri.x];
+    const glm::vec3 v2 = vertices[tri.y];
+    const glm::vec3 v3 = vertices[tri.z];
+    min = glm::min(v1, glm::min(v2, v3));
+    max = glm::max(v1, glm::max(v2, v3));
+    center = (v1 + v2 + v3) / 3.0f;
 }
 
 float BaseModel::evaluateSplit(glm::vec4 min, glm::vec4 max, int axis, float pos) const {
@@ -269,21 +491,16 @@ float BaseModel::evaluateSplit(glm::vec4 min, glm::vec4 max, int axis, float pos
     int numTri = -int(max.w);
 
     for (int i = triStart; i < numTri+triStart; ++i) {
-        glm::ivec3 tri = triangles[i];
-        glm::vec3 v1 = vertices[tri.x];
-        glm::vec3 v2 = vertices[tri.y];
-        glm::vec3 v3 = vertices[tri.z];
-        glm::vec3 center = (v1 + v2 + v3) / 3.0f;
+        glm::vec3 lo, hi, center;
+        triangleBounds(i, lo, hi, center);
 
         if (center[axis] < pos) {
-            growToInclude(minA, maxA, v1);
-            growToInclude(minA, maxA, v2);
-            growToInclude(minA, maxA, v3);
+            growToInclude(minA, maxA, lo);
+            growToInclude(minA, maxA, hi);
             maxA.w --;
         } else {
-            growToInclude(minB, maxB, v1);
-            growToInclude(minB, maxB, v2);
-            growToInclude(minB, maxB, v3);
+            growToInclude(minB, maxB, lo);
+            growToInclude(minB, maxB, hi);
             maxB.w --;
         }
     }
@@ -313,13 +530,14 @@ void BaseModel::chooseSplit(const int numTestsPerAxis, glm::vec4 min, glm::vec4
 
 }
 
-void BaseModel::split(int numTestsPerAxis, glm::vec4& bboxMin, glm::vec4& bboxMax, int depth) {
-    if (depth <= 0) {return;};
+bool BaseModel::split(int numTestsPerAxis, int index) {
+    glm::vec4& bboxMin = boundingBoxMin[index];
+    glm::vec4& bboxMax = boundingBoxMax[index];
 
     int triStart = -int(bboxMin.w);
     int numTris = -int(bboxMax.w);
 
-    if (numTris <= 1) {return;}
+    if (numTris <= 1) {return false;}
 
     auto minA = glm::vec3(1000000000.0f);
     auto minB = glm::vec3(1000000000.0f);
@@ -343,29 +561,28 @@ void BaseModel::split(int numTestsPerAxis, glm::vec4& bboxMin, glm::vec4& bboxMa
 
     float bestCost = 1000000000000.0f;
     chooseSplit(numTestsPerAxis, bboxMin, bboxMax, splitAxis, splitPos, bestCost);
-    if (bestCost >= nodeCost(bboxMin, bboxMax)) {return;}
+    if (bestCost >= nodeCost(bboxMin, bboxMax)) {return false;}
 
     //std::cout << depth << ' ' << splitAxix << ' ' << splitPos << std::endl;
 
     for (int i = triStart; i < triStart+numTris; i++) {
-        glm::ivec3 tri = triangles[i];
-        glm::vec3 v1 = vertices[tri.x];
-        glm::vec3 v2 = vertices[tri.y];
-        glm::vec3 v3 = vertices[tri.z];
-        glm::vec3 center = (v1 + v2 + v3)/3.0f;
+        glm::vec3 lo, hi, center;
+        triangleBounds(i, lo, hi, center);
         bool triInA = center[splitAxis] < splitPos;
         if (triInA) {
-            growToInclude(minA, maxA, v1);
-            growToInclude(minA, maxA, v2);
-            growToInclude(minA, maxA, v3);
+            growToInclude(minA, maxA, lo);
+            growToInclude(minA, maxA, hi);
             numA++;
             startB ++;
             int swap = startA + numA - 1;
             std::swap(triangles[i], triangles[swap]);
+            if (!referenceMin.empty()) {
+                std::swap(referenceMin[i], referenceMin[swap]);
+                std::swap(referenceMax[i], referenceMax[swap]);
+            }
         } else {
-            growToInclude(minB, maxB, v1);
-            growToInclude(minB, maxB, v2);
-            growToInclude(minB, maxB, v3);
+            growToInclude(minB, maxB, lo);
+            growToInclude(minB, maxB, hi);
             numB++;
         }
     }
@@ -382,22 +599,17 @@ void BaseModel::split(int numTestsPerAxis, glm::vec4& bboxMin, glm::vec4& bboxMa
         auto minBOut = glm::vec4(minB, -startB);
         auto maxBOut = glm::vec4(maxB, -numB);
 
-        boundingBoxMin.emplace_back(0);
-        boundingBoxMax.emplace_back(0);
-        boundingBoxMin.emplace_back(0);
-        boundingBoxMax.emplace_back(0);
-        int indexA = int(boundingBoxMin.size())-2;
-        int indexB = int(boundingBoxMax.size())-1;
-
-        bboxMin.w = float(indexA);
-        bboxMax.w = float(indexB);
-
-        split(numTestsPerAxis, minAOut, maxAOut, depth-1);
-        split(numTestsPerAxis, minBOut, maxBOut, depth-1);
-
-        boundingBoxMin[indexA] = minAOut;
-        boundingBoxMax[indexA] = maxAOut;
-        boundingBoxMin[indexB] = minBOut;
-        boundingBoxMax[indexB] = maxBOut;
+        int indexA = int(boundingBoxMin.size());
+        int indexB = indexA + 1;
+
+        // the appends may move the arrays, so the node is written through its index
+        boundingBoxMin[index].w = float(indexA);
+        boundingBoxMax[index].w = float(indexB);
+        boundingBoxMin.emplace_back(minAOut);
+        boundingBoxMax.emplace_back(maxAOut);
+        boundingBoxMin.emplace_back(minBOut);
+        boundingBoxMax.emplace_back(maxBOut);
+        return true;
     }
+    return false;
 }
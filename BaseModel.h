@@ -7,7 +7,42 @@
 
 #include <glm/glm.hpp>
 #include <string>
-#include <GLFW/glfw3.h>
+#include <vector>
+
+// Order the nodes are stored in after the build. Build keeps the builder's
+// own order and leaves the vertices alone; the others also renumber vertices
+// in the order the leaves first use them. DepthFirst stores sibling pairs in
+// preorder, VanEmdeBoas recursively groups subtrees of half the height so
+// nodes fetched together share cache lines at every cache size.
+enum class NodeOrder { Build, DepthFirst, VanEmdeBoas };
+
+// Binned is the centroid split search in split(), SpatialSplit the SBVH
+// builder in SpatialSplitBuilder.h, PLOC the bottom-up builder in PLOCBuilder.h
+enum class Builder { Binned, SpatialSplit, PLOC };
+
+struct BuildOptions {
+    NodeOrder order = NodeOrder::DepthFirst;
+    Builder builder = Builder::Binned;
+    // levels the binned and SBVH builders may go down, 0 for no limit
+    int maxDepth = 0;
+    // extra triangle references the SBVH may create, as a fraction of the triangle count
+    float duplicationBudget = 0.25f;
+    // time for treelet restructuring after the build (TreeOptimizer.h), 0 skips them
+    double optimizeMs = 0;
+    // extra references early split clipping may add for large triangles before a binned
+    // build, as a fraction of the triangle count (EarlySplit.h), 0 skips it
+    float earlySplitBudget = 0;
+    // triangles whose box area is above this share of the mesh's box area get split
+    float earlySplitThreshold = 0.01f;
+    // weld, degenerate and duplicate removal before the build (MeshCleanup.h)
+    bool cleanup = false;
+    // welding distance as a fraction of the mesh's bounding box diagonal
+    float weldTolerance = 1e-6f;
+    // coarser copies simplified after cleanup (MeshSimplifier.h), each with its own BVH, 0 for none
+    int lodLevels = 0;
+    // triangles each level keeps of the one before
+    float lodRatio = 0.25f;
+};
 
 class BaseModel {
     public:
@@ -20,18 +55,51 @@ class BaseModel {
     std::vector<glm::vec4> boundingBoxMin;
     std::vector<glm::vec4> boundingBoxMax;
 
+    // per triangle bounds while createBVH runs after earlySplit() (EarlySplit.h), empty otherwise
+    std::vector<glm::vec3> referenceMin;
+    std::vector<glm::vec3> referenceMax;
+
+    // simplified levels from finest to coarsest, built with the same options, empty without lodLevels
+    std::vector<BaseModel> lods;
+    // simplification error of this level in model units, 0 for the full mesh
+    float lodError = 0;
+
     BaseModel();
 
     static void parse(const std::string& nfilename, std::vector<glm::vec3>& vertices, std::vector<glm::ivec3>& triangles);
 
-    explicit BaseModel(const std::string& filename);
+    // whole file plus a null terminator, empty if it could not be opened
+    static std::vector<char> readFile(const std::string& filename);
+
+    static void parse(const std::vector<char>& buffer, std::vector<glm::vec3>& vertices, std::vector<glm::ivec3>& triangles);
+
+    explicit BaseModel(const std::string& filename, const BuildOptions& options = {});
+
+    // takes the output of parse() and builds the BVH
+    void build(const std::vector<glm::vec3>& tempVertices, const std::vector<glm::ivec3>& tempTriangles, const BuildOptions& options = {});
+
+    // builds the tree over triangles [triStart, triStart + numTris) and puts it in the requested order
+    void buildTree(int triStart, int numTris, const BuildOptions& options);
+
+    // simplifies the mesh as it is into lods, options.lodLevels of them at most
+    void buildLods(const BuildOptions& options);
+
+    // renumbers vertices in leaf order and drops unused ones
+    void reorderVertices();
+
+    void reorderNodes(NodeOrder order);
+
+    // box and split centroid of triangle i, from its reference bounds when there are any
+    void triangleBounds(int i, glm::vec3& min, glm::vec3& max, glm::vec3& center) const;
 
     [[nodiscard]] float evaluateSplit(glm::vec4 min, glm::vec4 max, int axis, float pos) const;
 
     void chooseSplit(int numTestsPerAxis, glm::vec4 min, glm::vec4 max, int& bestAxis, float& bestPos, float& bestCost) const;
 
-    void split(int numTestsPerAxis, glm::vec4& bboxMin, glm::vec4& bboxMax, int depth);
+    // splits the leaf at index into two appended children, false if it stays a leaf
+    bool split(int numTestsPerAxis, int index);
 
+    // builds iteratively, depth caps the levels below and including the root
     void createBVH(int depth, int numTestsPerAxis, int triStart, int numTris);
 };
 
@@ -0,0 +1,63 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "CameraPath.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+void CameraPath::record(const glm::vec3 position, const glm::vec3 forward) {
+    poses.push_back({position, forward});
+}
+
+bool CameraPath::save(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+
+    // 9 significant digits round-trip a float exactly
+    file << "# px py pz fx fy fz\n" << std::setprecision(9);
+    for (const Pose& pose : poses) {
+        file << pose.position.x << ' ' << pose.position.y << ' ' << pose.position.z << ' '
+             << pose.forward.x << ' ' << pose.forward.y << ' ' << pose.forward.z << '\n';
+    }
+    std::cout << "Saved " << poses.size() << " camera poses to " << filename << std::endl;
+    return file.good();
+}
+
+bool CameraPath::load(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+
+    poses.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream values(line);
+        Pose pose{};
+        if (!(values >> pose.position.x >> pose.position.y >> pose.position.z
+                     >> pose.forward.x >> pose.forward.y >> pose.forward.z)) {
+            std::cerr << "Bad camera pose in " << filename << ": " << line << std::endl;
+            return false;
+        }
+        poses.push_back(pose);
+    }
+    std::cout << "Loaded " << poses.size() << " camera poses from " << filename << std::endl;
+    return !poses.empty();
+}
+
+int CameraPath::size() const {
+    return int(poses.size());
+}
+
+const CameraPath::Pose& CameraPath::operator[](const int frame) const {
+    return poses[frame];
+}
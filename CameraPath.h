@@ -0,0 +1,37 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Camera pose per frame, recorded from a live session and replayed one pose
+// per frame so performance runs see identical views.
+// File format: one "px py pz fx fy fz" line per frame, '#' starts a comment.
+class CameraPath {
+    public:
+    struct Pose {
+        glm::vec3 position;
+        glm::vec3 forward;
+    };
+
+    private:
+    std::vector<Pose> poses;
+
+    public:
+    void record(glm::vec3 position, glm::vec3 forward);
+
+    [[nodiscard]] bool save(const std::string& filename) const;
+
+    bool load(const std::string& filename);
+
+    [[nodiscard]] int size() const;
+
+    [[nodiscard]] const Pose& operator[](int frame) const;
+};
+
+#endif //CAMERAPATH_H
@@ -0,0 +1,117 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "EarlySplit.h"
+
+#include <iostream>
+#include <queue>
+
+float referenceArea(const glm::vec3 min, const glm::vec3 max) {
+    const glm::vec3 size = glm::max(max - min, glm::vec3(0));
+    return size.x * (size.y + size.z) + size.y * size.z;
+}
+
+// bounds of the part of the triangle inside the box, false if none of it is
+bool clipTriangle(const glm::vec3 (&corners)[3], const glm::vec3 boxMin, const glm::vec3 boxMax,
+                  glm::vec3& outMin, glm::vec3& outMax) {
+    // each of the six planes adds at most one vertex to the polygon
+    glm::vec3 polygon[9], clipped[9];
+    int count = 3;
+    for (int i = 0; i < 3; ++i) polygon[i] = corners[i];
+    for (int plane = 0; plane < 6 && count > 0; ++plane) {
+        const int axis = plane / 2;
+        const float bound = plane % 2 == 0 ? boxMin[axis] : boxMax[axis];
+        const float sign = plane % 2 == 0 ? 1.0f : -1.0f;
+        int kept = 0;
+        for (int i = 0; i < count; ++i) {
+            const glm::vec3 a = polygon[i], b = polygon[(i + 1) % count];
+            const float da = (a[axis] - bound) * sign, db = (b[axis] - bound) * sign;
+            if (da >= 0) clipped[kept++] = a;
+            if ((da < 0) != (db < 0)) clipped[kept++] = a + (b - a) * (da / (da - db));
+        }
+        count = kept;
+        for (int i = 0; i < count; ++i) polygon[i] = clipped[i];
+    }
+    if (count == 0) return false;
+
+    outMin = glm::vec3(1e30f);
+    outMax = glm::vec3(-1e30f);
+    for (int i = 0; i < count; ++i) {
+        outMin = glm::min(outMin, polygon[i]);
+        outMax = glm::max(outMax, polygon[i]);
+    }
+    // intersection points can land a rounding error outside the box
+    outMin = glm::max(outMin, boxMin);
+    outMax = glm::min(outMax, boxMax);
+    return true;
+}
+
+int earlySplit(BaseModel& model, const float threshold, const float budget) {
+    const int numTris = int(model.triangles.size());
+    model.referenceMin.resize(numTris);
+    model.referenceMax.resize(numTris);
+
+    glm::vec3 meshMin(1e30f), meshMax(-1e30f);
+    for (int i = 0; i < numTris; ++i) {
+        const glm::ivec3 tri = model.triangles[i];
+        model.referenceMin[i] = glm::min(model.vertices[tri.x], glm::min(model.vertices[tri.y], model.vertices[tri.z]));
+        model.referenceMax[i] = glm::max(model.vertices[tri.x], glm::max(model.vertices[tri.y], model.vertices[tri.z]));
+        meshMin = glm::min(meshMin, model.referenceMin[i]);
+        meshMax = glm::max(meshMax, model.referenceMax[i]);
+    }
+    const float minArea = threshold * referenceArea(meshMin, meshMax);
+    const int maxExtra = int(budget * float(numTris));
+
+    // largest reference first, so a small budget still goes where it matters most
+    std::priority_queue<std::pair<float, int>> largest;
+    for (int i = 0; i < numTris; ++i) {
+        const float area = referenceArea(model.referenceMin[i], model.referenceMax[i]);
+        if (area > minArea) largest.emplace(area, i);
+    }
+    if (largest.empty()) {
+        // nothing to split, createBVH keeps building from the vertices
+        std::vector<glm::vec3>().swap(model.referenceMin);
+        std::vector<glm::vec3>().swap(model.referenceMax);
+        return 0;
+    }
+
+    int added = 0;
+    while (!largest.empty() && added < maxExtra) {
+        const int ref = largest.top().second;
+        largest.pop();
+        const glm::vec3 min = model.referenceMin[ref], max = model.referenceMax[ref];
+        const glm::vec3 size = max - min;
+        const int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+        glm::vec3 middleMax = max, middleMin = min;
+        middleMax[axis] = middleMin[axis] = (min[axis] + max[axis]) * 0.5f;
+
+        const glm::ivec3 tri = model.triangles[ref];
+        const glm::vec3 corners[3] = {model.vertices[tri.x], model.vertices[tri.y], model.vertices[tri.z]};
+        glm::vec3 lowMin, lowMax, highMin, highMax;
+        const bool low = clipTriangle(corners, min, middleMax, lowMin, lowMax);
+        const bool high = clipTriangle(corners, middleMin, max, highMin, highMax);
+        if (!low || !high) {
+            // the triangle only touches one half, which is then just a tighter box
+            model.referenceMin[ref] = low ? lowMin : highMin;
+            model.referenceMax[ref] = low ? lowMax : highMax;
+        } else {
+            model.referenceMin[ref] = lowMin;
+            model.referenceMax[ref] = lowMax;
+            model.triangles.push_back(tri);
+            model.referenceMin.push_back(highMin);
+            model.referenceMax.push_back(highMax);
+            added++;
+            const float area = referenceArea(highMin, highMax);
+            if (area > minArea) largest.emplace(area, int(model.triangles.size()) - 1);
+        }
+        const float area = referenceArea(model.referenceMin[ref], model.referenceMax[ref]);
+        // a box that stopped shrinking is as tight as clipping gets it
+        if (area > minArea && area < referenceArea(min, max)) largest.emplace(area, ref);
+    }
+
+    std::cout << "Early split: " << numTris << " triangles, " << model.triangles.size() << " references (+"
+              << 100.0f * float(added) / float(std::max(numTris, 1)) << "%), " << largest.size()
+              << " still above the threshold" << std::endl;
+    return added;
+}
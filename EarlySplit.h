@@ -0,0 +1,21 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef EARLYSPLIT_H
+#define EARLYSPLIT_H
+
+#include "BaseModel.h"
+
+// Early split clipping (Ernst and Greiner 2007), run before createBVH.
+// Triangles whose box covers more than threshold of the mesh's box area are
+// split into several references, each a copy of the original triangle with
+// the tighter bounds of the part of it inside a smaller box. The largest
+// reference is always split next, halving its box at the middle of its
+// longest axis, until none is above the threshold or the budget (extra
+// references as a fraction of the triangle count) is spent. The bounds go to
+// model.referenceMin / referenceMax, which createBVH builds from instead of
+// the vertices. Returns the number of references added.
+int earlySplit(BaseModel& model, float threshold, float budget);
+
+#endif //EARLYSPLIT_H
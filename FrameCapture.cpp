@@ -0,0 +1,217 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "FrameCapture.h"
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+FrameCapture::~FrameCapture() {
+    finish();
+}
+
+// The sequence target goes to snprintf as the format, so it may hold exactly
+// one integer conversion (%d with optional flags and width) and literal %%.
+static bool isFramePattern(const std::string& target) {
+    int conversions = 0;
+    for (size_t i = 0; i < target.size(); ++i) {
+        if (target[i] != '%') continue;
+        if (++i < target.size() && target[i] == '%') continue;
+        while (i < target.size() && std::strchr("-+ #0", target[i]) != nullptr) ++i;
+        while (i < target.size() && std::isdigit(static_cast<unsigned char>(target[i]))) ++i;
+        if (i >= target.size() || (target[i] != 'd' && target[i] != 'i')) return false;
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+bool FrameCapture::start(const std::string& target, const int width, const int height, const int fps) {
+    finish();
+
+    this->target = target;
+    this->width = width;
+    this->height = height;
+
+    const std::string ext = target.size() >= 4 ? target.substr(target.size() - 4) : "";
+    if (ext == ".y4m") format = Format::Y4M;
+    else if (ext == ".ppm") format = Format::PPM;
+    else if (ext == ".pfm") format = Format::PFM;
+    else format = Format::PNG;
+
+    if (format != Format::Y4M && !isFramePattern(target)) {
+        std::cerr << "Capture target needs exactly one frame number conversion like %05d: " << target << std::endl;
+        return false;
+    }
+
+    // only the HDR sequence needs the float values, everything else reads back 8-bit
+    frameBytes = size_t(width) * height * 4 * (format == Format::PFM ? sizeof(float) : 1);
+
+    if (format == Format::Y4M) {
+        stream.open(target, std::ios::binary);
+        if (!stream.is_open()) {
+            std::cerr << "Failed to open file: " << target << std::endl;
+            return false;
+        }
+        stream << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C444\n";
+    }
+
+    for (Slot& slot : slots) {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(frameBytes), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    head = tail = 0;
+    nextFrame = dropped = written = failed = 0;
+    stopping = false;
+    writer = std::thread(&FrameCapture::writerLoop, this);
+
+    active = true;
+    recording = true;
+    std::cout << "Capturing to " << target << std::endl;
+    return true;
+}
+
+void FrameCapture::capture(const GLuint framebuffer) {
+    poll();
+    if (!recording) return;
+
+    Slot& slot = slots[head];
+    if (slot.fence != nullptr) {
+        // the oldest readback is still in flight, skip instead of stalling
+        dropped++;
+        return;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, format == Format::PFM ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = nextFrame++;
+    head = (head + 1) % RING_SIZE;
+}
+
+void FrameCapture::poll(const bool wait) {
+    if (!active) return;
+
+    while (slots[tail].fence != nullptr) {
+        Slot& slot = slots[tail];
+        const GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+        if (status == GL_TIMEOUT_EXPIRED) return;
+
+        Frame frame{slot.frame, std::vector<unsigned char>(frameBytes)};
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        if (const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(frameBytes), GL_MAP_READ_BIT)) {
+            std::memcpy(frame.pixels.data(), mapped, frameBytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        tail = (tail + 1) % RING_SIZE;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!wait && queue.size() >= MAX_QUEUED) {
+                dropped++;
+                continue;
+            }
+            queue.emplace_back(std::move(frame));
+        }
+        ready.notify_one();
+    }
+}
+
+void FrameCapture::toggle() {
+    if (!active) return;
+    recording = !recording;
+    std::cout << (recording ? "Capture resumed" : "Capture paused") << std::endl;
+}
+
+void FrameCapture::finish() {
+    if (!active) return;
+
+    poll(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_one();
+    writer.join();
+
+    for (Slot& slot : slots) {
+        if (slot.fence != nullptr) glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.pbo);
+        slot = Slot();
+    }
+    if (stream.is_open()) stream.close();
+
+    active = false;
+    recording = false;
+    std::cout << "Captured " << written << " frames to " << target << " (" << dropped << " dropped";
+    if (failed > 0) std::cout << ", " << failed << " failed to write";
+    std::cout << ")" << std::endl;
+}
+
+bool FrameCapture::isRecording() const {
+    return recording;
+}
+
+void FrameCapture::writerLoop() {
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        if (write(frame)) {
+            written++;
+        } else if (failed++ == 0) {
+            // reported once, the rest are counted for finish()
+            std::cerr << "Failed to write captured frame " << frame.index << " to " << target << std::endl;
+        }
+    }
+}
+
+bool FrameCapture::write(const Frame& frame) {
+    if (format == Format::Y4M) return writeY4M(frame.pixels);
+
+    char path[1024];
+    const int length = std::snprintf(path, sizeof(path), target.c_str(), frame.index);
+    if (length < 0 || length >= int(sizeof(path))) return false;
+    if (format == Format::PFM) return writePFM(path, width, height, reinterpret_cast<const float*>(frame.pixels.data()));
+    if (format == Format::PPM) return writePPM(path, width, height, frame.pixels.data());
+    return writePNG(path, width, height, frame.pixels.data());
+}
+
+bool FrameCapture::writeY4M(const std::vector<unsigned char>& rgba) {
+    // 4:4:4 planes, BT.601 studio range, rows flipped to top-down
+    const size_t pixels = size_t(width) * height;
+    std::vector<unsigned char> planes(pixels * 3);
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* src = rgba.data() + size_t(height - 1 - y) * width * 4;
+        for (int x = 0; x < width; ++x) {
+            const float r = src[x*4+0], g = src[x*4+1], b = src[x*4+2];
+            const size_t i = size_t(y) * width + x;
+            planes[i]            = static_cast<unsigned char>(std::clamp( 16.0f + 0.2568f*r + 0.5041f*g + 0.0979f*b, 0.0f, 255.0f));
+            planes[pixels + i]   = static_cast<unsigned char>(std::clamp(128.0f - 0.1482f*r - 0.2910f*g + 0.4392f*b, 0.0f, 255.0f));
+            planes[2*pixels + i] = static_cast<unsigned char>(std::clamp(128.0f + 0.4392f*r - 0.3678f*g - 0.0714f*b, 0.0f, 255.0f));
+        }
+    }
+    stream << "FRAME\n";
+    stream.write(reinterpret_cast<const char*>(planes.data()), std::streamsize(planes.size()));
+    return stream.good();
+}
@@ -0,0 +1,97 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <glad/glad.h>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams accumulated frames to disk without stalling the render loop.
+// Each capture() reads the framebuffer into the next pixel pack buffer of a
+// small ring and fences it; poll() maps the buffers whose fence has signaled
+// (usually a frame or two later) and hands the pixels to a writer thread.
+// Output is picked from the target's extension: an image sequence for
+// .png/.ppm/.pfm (printf pattern, e.g. frames/frame_%05d.png) or a single
+// raw .y4m stream. Frames are dropped, never waited on, when the ring or the
+// writer queue is full.
+class FrameCapture {
+    static constexpr int RING_SIZE = 3;
+    static constexpr int MAX_QUEUED = 8;
+
+    enum class Format { PNG, PPM, PFM, Y4M };
+
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        int frame = -1;
+    };
+
+    struct Frame {
+        int index;
+        std::vector<unsigned char> pixels;
+    };
+
+    std::string target;
+    Format format = Format::PNG;
+    int width = 0, height = 0;
+    size_t frameBytes = 0;
+
+    Slot slots[RING_SIZE];
+    int head = 0;
+    int tail = 0;
+
+    bool active = false;
+    bool recording = false;
+    int nextFrame = 0;
+    int dropped = 0;
+    int written = 0;
+    // frames the writer thread couldn't write, read after it joined
+    int failed = 0;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Frame> queue;
+    bool stopping = false;
+    std::ofstream stream;
+
+    void writerLoop();
+
+    // returns whether the frame reached the disk
+    bool write(const Frame& frame);
+
+    bool writeY4M(const std::vector<unsigned char>& rgba);
+
+    public:
+    FrameCapture() = default;
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+    ~FrameCapture();
+
+    // target is a printf pattern with one integer conversion for image sequences
+    bool start(const std::string& target, int width, int height, int fps);
+
+    // queues an asynchronous readback of the framebuffer's color attachment
+    // and polls the earlier ones, call once per frame
+    void capture(GLuint framebuffer);
+
+    // hands finished readbacks to the writer, blocking on fences only when wait is set
+    void poll(bool wait = false);
+
+    void toggle();
+
+    // drains the ring and the writer queue
+    void finish();
+
+    [[nodiscard]] bool isRecording() const;
+};
+
+#endif //FRAMECAPTURE_H
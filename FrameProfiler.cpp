@@ -0,0 +1,163 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+FrameProfiler::Summary summarize(std::vector<double> times) {
+    FrameProfiler::Summary summary;
+    times.erase(std::remove_if(times.begin(), times.end(), [](const double t) { return t < 0; }), times.end());
+    if (times.empty()) return summary;
+
+    std::sort(times.begin(), times.end());
+    summary.frames = int(times.size());
+    for (const double t : times) summary.mean += t;
+    summary.mean /= double(times.size());
+    summary.median = times[times.size() / 2];
+    summary.p95 = times[std::min(times.size() - 1, times.size() * 95 / 100)];
+    summary.max = times.back();
+    return summary;
+}
+
+GLuint FrameProfiler::acquire() {
+    if (freeQueries.empty()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        allQueries.push_back(query);
+        return query;
+    }
+    const GLuint query = freeQueries.back();
+    freeQueries.pop_back();
+    return query;
+}
+
+void FrameProfiler::setLabel(const std::string& label) {
+    for (int i = 0; i < int(labels.size()); ++i) {
+        if (labels[i] == label) {
+            currentLabel = i;
+            return;
+        }
+    }
+    labels.push_back(label);
+    currentLabel = int(labels.size()) - 1;
+}
+
+void FrameProfiler::begin() {
+    activeQuery = acquire();
+    cpuStart = std::chrono::steady_clock::now();
+    glQueryCounter(activeQuery, GL_TIMESTAMP);
+}
+
+void FrameProfiler::end() {
+    const GLuint endQuery = acquire();
+    glQueryCounter(endQuery, GL_TIMESTAMP);
+    const auto now = std::chrono::steady_clock::now();
+    const auto since = cpuMs.empty() ? cpuStart : lastEnd;
+    cpuMs.push_back(std::chrono::duration<double, std::milli>(now - since).count());
+    lastEnd = now;
+    gpuMs.push_back(-1);
+    frameLabels.push_back(currentLabel);
+    pending.push_back({activeQuery, endQuery, int(gpuMs.size()) - 1});
+    activeQuery = 0;
+
+    collect(false);
+}
+
+void FrameProfiler::collect(const bool wait) {
+    while (!pending.empty()) {
+        const Pending& front = pending.front();
+        if (!wait) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(front.end, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return;
+        }
+        GLuint64 startTime = 0, endTime = 0;
+        glGetQueryObjectui64v(front.start, GL_QUERY_RESULT, &startTime);
+        glGetQueryObjectui64v(front.end, GL_QUERY_RESULT, &endTime);
+        gpuMs[front.frame] = double(endTime - startTime) / 1.0e6;
+        latestGpuFrame = front.frame;
+        freeQueries.push_back(front.start);
+        freeQueries.push_back(front.end);
+        pending.pop_front();
+    }
+}
+
+void FrameProfiler::resolve() {
+    collect(true);
+}
+
+void FrameProfiler::release() {
+    resolve();
+    if (!allQueries.empty()) glDeleteQueries(GLsizei(allQueries.size()), allQueries.data());
+    allQueries.clear();
+    freeQueries.clear();
+}
+
+int FrameProfiler::frames() const {
+    return int(cpuMs.size());
+}
+
+int FrameProfiler::latestGpu(double& ms) const {
+    ms = latestGpuFrame >= 0 ? gpuMs[latestGpuFrame] : 0;
+    return latestGpuFrame;
+}
+
+FrameProfiler::Summary FrameProfiler::gpuSummary() const {
+    return summarize(gpuMs);
+}
+
+FrameProfiler::Summary FrameProfiler::cpuSummary() const {
+    return summarize(cpuMs);
+}
+
+std::vector<double> FrameProfiler::select(const std::vector<double>& times, const int label) const {
+    std::vector<double> out;
+    for (size_t i = 0; i < times.size(); ++i) {
+        if (frameLabels[i] == label) out.push_back(times[i]);
+    }
+    return out;
+}
+
+void printTimes(const FrameProfiler::Summary& gpu, const FrameProfiler::Summary& cpu) {
+    std::cout << "  -  GPU ms  mean: " << gpu.mean << "  median: " << gpu.median << "  p95: " << gpu.p95 << "  max: " << gpu.max << std::endl;
+    std::cout << "  -  CPU ms  mean: " << cpu.mean << "  median: " << cpu.median << "  p95: " << cpu.p95 << "  max: " << cpu.max << std::endl;
+}
+
+void FrameProfiler::printSummary(const std::string& title) const {
+    const Summary gpu = gpuSummary();
+    std::cout << title << " (" << gpu.frames << " frames)" << std::endl;
+    printTimes(gpu, cpuSummary());
+
+    int baseline = -1;
+    for (int label = 0; label < int(labels.size()); ++label) {
+        const Summary labelGpu = summarize(select(gpuMs, label));
+        if (labelGpu.frames == 0 || labelGpu.frames == gpu.frames) continue;
+        if (baseline < 0) baseline = label;
+        const Summary baseGpu = summarize(select(gpuMs, baseline));
+
+        std::cout << labels[label] << " (" << labelGpu.frames << " frames)";
+        if (label != baseline && baseGpu.median > 0) {
+            std::cout << "  -  " << (labelGpu.median - baseGpu.median) / baseGpu.median * 100.0 << "% vs " << labels[baseline];
+        }
+        std::cout << std::endl;
+        printTimes(labelGpu, summarize(select(cpuMs, label)));
+    }
+}
+
+bool FrameProfiler::writeReport(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+    file << "frame,label,gpu_ms,cpu_ms\n";
+    for (size_t i = 0; i < cpuMs.size(); ++i) {
+        file << i << ',' << labels[frameLabels[i]] << ',' << gpuMs[i] << ',' << cpuMs[i] << '\n';
+    }
+    std::cout << "Wrote frame timings to " << filename << std::endl;
+    return file.good();
+}
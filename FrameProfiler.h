@@ -0,0 +1,84 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <glad/glad.h>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Per-frame GPU (a GL_TIMESTAMP pair around the trace pass) and CPU (wall time
+// between consecutive end() calls) timings. Query results are picked up once
+// available, a few frames later, so timing never stalls the loop.
+// Timestamps rather than GL_TIME_ELAPSED: llvmpipe drops the start of the
+// first elapsed query.
+class FrameProfiler {
+    struct Pending {
+        GLuint start, end;
+        int frame;
+    };
+
+    std::vector<GLuint> freeQueries;
+    std::vector<GLuint> allQueries;
+    std::deque<Pending> pending;
+
+    std::vector<double> gpuMs;
+    std::vector<double> cpuMs;
+    // newest frame whose queries came back
+    int latestGpuFrame = -1;
+
+    // frames are tagged with the label active when they were timed (e.g. the shader variant)
+    std::vector<std::string> labels{"default"};
+    std::vector<int> frameLabels;
+    int currentLabel = 0;
+
+    [[nodiscard]] std::vector<double> select(const std::vector<double>& times, int label) const;
+
+    std::chrono::steady_clock::time_point cpuStart;
+    std::chrono::steady_clock::time_point lastEnd;
+    GLuint activeQuery = 0;
+
+    GLuint acquire();
+
+    void collect(bool wait);
+
+    public:
+    struct Summary {
+        int frames = 0;
+        double mean = 0, median = 0, p95 = 0, max = 0;
+    };
+
+    void setLabel(const std::string& label);
+
+    void begin();
+
+    void end();
+
+    // waits for every outstanding query
+    void resolve();
+
+    // deletes the query objects, call while the context is still current
+    void release();
+
+    [[nodiscard]] int frames() const;
+
+    // the newest frame with its GPU time known and that time, -1 before any came back
+    [[nodiscard]] int latestGpu(double& ms) const;
+
+    [[nodiscard]] Summary gpuSummary() const;
+
+    [[nodiscard]] Summary cpuSummary() const;
+
+    // overall times, then per label with the GPU median delta against the first
+    // label (median so one-off compile hitches after a switch don't dominate)
+    void printSummary(const std::string& title) const;
+
+    // CSV with one "frame,label,gpu_ms,cpu_ms" row per frame
+    [[nodiscard]] bool writeReport(const std::string& filename) const;
+};
+
+#endif //FRAMEPROFILER_H
@@ -0,0 +1,79 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "GpuBuffer.h"
+
+#include <algorithm>
+
+GpuBuffer::GpuBuffer(const GLuint binding) : binding(binding) {}
+
+void GpuBuffer::reserve(const size_t bytes) {
+    if (buffer != 0 && bytes <= capacity) return;
+
+    // grow by half so a stream of appends stays cheap without doubling memory
+    const size_t newCapacity = std::max<size_t>({bytes, capacity + capacity / 2, 256});
+    GLuint newBuffer;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(newCapacity), nullptr, GL_DYNAMIC_DRAW);
+
+    if (buffer != 0) {
+        if (valid > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(valid));
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+
+    buffer = newBuffer;
+    capacity = newCapacity;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+}
+
+void GpuBuffer::invalidate(const size_t offset) {
+    valid = std::min(valid, offset);
+}
+
+size_t GpuBuffer::sync(const void* data, const size_t bytes, StagingRing& staging, const size_t base) {
+    if (bytes <= valid) {
+        // the array shrank, the stale tail is simply never read again
+        valid = bytes;
+        if (buffer == 0) reserve(0);
+        return 0;
+    }
+
+    if (valid == 0 && buffer != 0 && bytes <= capacity) {
+        // full rewrite: orphan the old storage so the driver doesn't wait for frames still reading it
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(capacity), nullptr, GL_DYNAMIC_DRAW);
+    }
+    reserve(bytes);
+
+    const size_t offset = valid;
+    staging.upload(buffer, offset, static_cast<const char*>(data) + (offset - base), bytes - offset);
+    valid = bytes;
+    return bytes - offset;
+}
+
+size_t GpuBuffer::patch(const void* data, const size_t offset, const size_t bytes, StagingRing& staging) {
+    if (offset >= valid) return 0;
+    const size_t clipped = std::min(bytes, valid - offset);
+    staging.upload(buffer, offset, data, clipped);
+    return clipped;
+}
+
+void GpuBuffer::release() {
+    if (buffer != 0) glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    capacity = 0;
+    valid = 0;
+}
+
+size_t GpuBuffer::getCapacity() const {
+    return capacity;
+}
+
+GLuint GpuBuffer::getBuffer() const {
+    return buffer;
+}
@@ -0,0 +1,47 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef GPUBUFFER_H
+#define GPUBUFFER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+
+#include "StagingRing.h"
+
+// Shader storage buffer mirroring a CPU array. It remembers how many leading
+// bytes are already on the GPU, so sync() only uploads what was appended or
+// invalidated since the last call. Growing allocates a larger buffer and
+// copies the old contents on the GPU instead of re-uploading them.
+class GpuBuffer {
+    GLuint buffer = 0;
+    GLuint binding;
+    size_t capacity = 0;
+    size_t valid = 0;
+
+    void reserve(size_t bytes);
+
+    public:
+    explicit GpuBuffer(GLuint binding);
+
+    // marks everything from offset onwards as needing an upload
+    void invalidate(size_t offset);
+
+    // uploads the out of date tail of an array of bytes through staging and
+    // returns the number of bytes sent. data holds the array from byte base
+    // onwards, everything before base must already be on the GPU
+    size_t sync(const void* data, size_t bytes, StagingRing& staging, size_t base = 0);
+
+    // rewrites bytes in place at offset, e.g. a range that was edited on the host.
+    // Whatever lies past the uploaded prefix is left for the next sync()
+    size_t patch(const void* data, size_t offset, size_t bytes, StagingRing& staging);
+
+    void release();
+
+    [[nodiscard]] size_t getCapacity() const;
+
+    [[nodiscard]] GLuint getBuffer() const;
+};
+
+#endif //GPUBUFFER_H
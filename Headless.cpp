@@ -0,0 +1,108 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#define EGL_NO_X11
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "Headless.h"
+
+#include <cstring>
+#include <iostream>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+bool HeadlessContext::create(const int major, const int minor) {
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (clientExtensions != nullptr && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != nullptr) {
+        const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay != nullptr) {
+            eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+    }
+    if (eglDisplay == EGL_NO_DISPLAY) {
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint eglMajor, eglMinor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &eglMajor, &eglMinor)) {
+        std::cerr << "Failed to initialize EGL display\n";
+        return false;
+    }
+    display = eglDisplay;
+
+    const char* extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+    if (extensions == nullptr || std::strstr(extensions, "EGL_KHR_surfaceless_context") == nullptr) {
+        std::cerr << "EGL_KHR_surfaceless_context not supported\n";
+        destroy();
+        return false;
+    }
+
+    constexpr EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        // surfaceless displays may expose no configs at all, EGL_KHR_no_config_context covers that
+        config = nullptr;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "Failed to bind the desktop OpenGL API\n";
+        destroy();
+        return false;
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major,
+        EGL_CONTEXT_MINOR_VERSION, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttribs);
+    if (eglContext == EGL_NO_CONTEXT) {
+        std::cerr << "Failed to create OpenGL " << major << "." << minor << " context\n";
+        destroy();
+        return false;
+    }
+    context = eglContext;
+
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+        std::cerr << "Failed to make the headless context current\n";
+        destroy();
+        return false;
+    }
+
+    std::cout << "EGL " << eglMajor << "." << eglMinor << " headless context" << std::endl;
+    return true;
+}
+
+bool HeadlessContext::loadGL() const {
+    if (context == nullptr || !gladLoadGL(getProcAddress)) {
+        std::cerr << "Failed to initialize GLAD\n";
+        return false;
+    }
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+    return true;
+}
+
+GLADapiproc HeadlessContext::getProcAddress(const char* name) {
+    return reinterpret_cast<GLADapiproc>(eglGetProcAddress(name));
+}
+
+void HeadlessContext::destroy() {
+    if (display == nullptr) return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != nullptr) eglDestroyContext(display, context);
+    eglTerminate(display);
+    context = nullptr;
+    display = nullptr;
+}
@@ -0,0 +1,27 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// Offscreen OpenGL 4.3 core context without a window, for servers and CI.
+// Uses a surfaceless EGL display (EGL_MESA_platform_surfaceless when present),
+// so it also runs on Mesa llvmpipe. All rendering goes to FBOs.
+class HeadlessContext {
+    void* display = nullptr;
+    void* context = nullptr;
+
+    public:
+    bool create(int major, int minor);
+
+    // loads the GL entry points through eglGetProcAddress
+    [[nodiscard]] bool loadGL() const;
+
+    // eglGetProcAddress with glad's loader signature
+    static void (*getProcAddress(const char* name))();
+
+    void destroy();
+};
+
+#endif //HEADLESS_H
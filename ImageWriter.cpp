@@ -0,0 +1,183 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+unsigned char toByte(const float value) {
+    return static_cast<unsigned char>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// top-down 8-bit RGB rows, the order PNG and PPM store them in
+std::vector<unsigned char> toRGB8(const int width, const int height, const float* rgba) {
+    std::vector<unsigned char> rgb(size_t(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        const float* src = rgba + size_t(height - 1 - y) * width * 4;
+        unsigned char* dst = rgb.data() + size_t(y) * width * 3;
+        for (int x = 0; x < width; ++x) {
+            dst[x*3+0] = toByte(src[x*4+0]);
+            dst[x*3+1] = toByte(src[x*4+1]);
+            dst[x*3+2] = toByte(src[x*4+2]);
+        }
+    }
+    return rgb;
+}
+
+std::vector<unsigned char> toRGB8(const int width, const int height, const unsigned char* rgba) {
+    std::vector<unsigned char> rgb(size_t(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* src = rgba + size_t(height - 1 - y) * width * 4;
+        unsigned char* dst = rgb.data() + size_t(y) * width * 3;
+        for (int x = 0; x < width; ++x) {
+            dst[x*3+0] = src[x*4+0];
+            dst[x*3+1] = src[x*4+1];
+            dst[x*3+2] = src[x*4+2];
+        }
+    }
+    return rgb;
+}
+
+uint32_t crc32(const unsigned char* data, const size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void putU32(std::vector<unsigned char>& out, const uint32_t v) {
+    out.push_back(v >> 24);
+    out.push_back(v >> 16);
+    out.push_back(v >> 8);
+    out.push_back(v);
+}
+
+void writeChunk(std::ofstream& file, const char type[4], const std::vector<unsigned char>& data) {
+    std::vector<unsigned char> chunk;
+    chunk.reserve(data.size() + 12);
+    putU32(chunk, uint32_t(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putU32(chunk, crc32(chunk.data() + 4, data.size() + 4));
+    file.write(reinterpret_cast<const char*>(chunk.data()), std::streamsize(chunk.size()));
+}
+
+bool writePNGRows(const std::string& path, const int width, const int height, const std::vector<unsigned char>& rgb) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+
+    const size_t stride = size_t(width) * 3;
+
+    // every scanline gets filter type 0 (none)
+    std::vector<unsigned char> raw;
+    raw.reserve((stride + 1) * height);
+    for (int y = 0; y < height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb.begin() + long(y * stride), rgb.begin() + long((y + 1) * stride));
+    }
+
+    // zlib stream made of stored (uncompressed) deflate blocks, so no dependency is needed
+    std::vector<unsigned char> idat = {0x78, 0x01};
+    size_t pos = 0;
+    do {
+        const size_t len = std::min<size_t>(65535, raw.size() - pos);
+        const bool last = pos + len == raw.size();
+        idat.push_back(last ? 1 : 0);
+        idat.push_back(len & 0xFF);
+        idat.push_back(len >> 8);
+        idat.push_back(~len & 0xFF);
+        idat.push_back((~len >> 8) & 0xFF);
+        idat.insert(idat.end(), raw.begin() + long(pos), raw.begin() + long(pos + len));
+        pos += len;
+    } while (pos < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (const unsigned char c : raw) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    putU32(idat, (b << 16) | a);
+
+    std::vector<unsigned char> ihdr;
+    putU32(ihdr, uint32_t(width));
+    putU32(ihdr, uint32_t(height));
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, deflate, no filter, no interlace
+
+    constexpr unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), 8);
+    writeChunk(file, "IHDR", ihdr);
+    writeChunk(file, "IDAT", idat);
+    writeChunk(file, "IEND", {});
+    return file.good();
+}
+
+bool writePPMRows(const std::string& path, const int width, const int height, const std::vector<unsigned char>& rgb) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+
+    file << "P6\n" << width << ' ' << height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(rgb.data()), std::streamsize(rgb.size()));
+    return file.good();
+}
+
+bool writePNG(const std::string& path, const int width, const int height, const float* rgba) {
+    return writePNGRows(path, width, height, toRGB8(width, height, rgba));
+}
+
+bool writePNG(const std::string& path, const int width, const int height, const unsigned char* rgba) {
+    return writePNGRows(path, width, height, toRGB8(width, height, rgba));
+}
+
+bool writePPM(const std::string& path, const int width, const int height, const float* rgba) {
+    return writePPMRows(path, width, height, toRGB8(width, height, rgba));
+}
+
+bool writePPM(const std::string& path, const int width, const int height, const unsigned char* rgba) {
+    return writePPMRows(path, width, height, toRGB8(width, height, rgba));
+}
+
+bool writePFM(const std::string& path, const int width, const int height, const float* rgba) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+
+    // PFM is stored bottom-up already, negative scale marks little endian
+    std::vector<float> rgb(size_t(width) * height * 3);
+    for (size_t i = 0; i < size_t(width) * height; ++i) {
+        rgb[i*3+0] = rgba[i*4+0];
+        rgb[i*3+1] = rgba[i*4+1];
+        rgb[i*3+2] = rgba[i*4+2];
+    }
+    file << "PF\n" << width << ' ' << height << "\n-1.0\n";
+    file.write(reinterpret_cast<const char*>(rgb.data()), std::streamsize(rgb.size() * sizeof(float)));
+    return file.good();
+}
+
+bool writeImage(const std::string& path, const int width, const int height, const float* rgba) {
+    const std::string ext = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+    if (ext == ".ppm") return writePPM(path, width, height, rgba);
+    if (ext == ".pfm") return writePFM(path, width, height, rgba);
+    return writePNG(path, width, height, rgba);
+}
@@ -0,0 +1,26 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <string>
+
+// Writes an RGBA float image read back from the accumulation texture.
+// Rows are expected bottom-up (OpenGL order). The format is picked from the
+// extension: .png and .ppm are 8-bit, .pfm keeps the full float values.
+bool writeImage(const std::string& path, int width, int height, const float* rgba);
+
+bool writePNG(const std::string& path, int width, int height, const float* rgba);
+
+bool writePPM(const std::string& path, int width, int height, const float* rgba);
+
+// 8-bit RGBA variants, same bottom-up row order
+bool writePNG(const std::string& path, int width, int height, const unsigned char* rgba);
+
+bool writePPM(const std::string& path, int width, int height, const unsigned char* rgba);
+
+bool writePFM(const std::string& path, int width, int height, const float* rgba);
+
+#endif //IMAGEWRITER_H
@@ -0,0 +1,151 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "MeshCleanup.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+// runs work(begin, end) over [0, count) split across the hardware threads,
+// with at least minPerThread items each so small meshes stay on one
+template <typename Work>
+void cleanupChunks(const size_t count, const size_t minPerThread, const Work& work) {
+    const size_t threads = std::clamp<size_t>(count / minPerThread, 1, std::max(1u, std::thread::hardware_concurrency()));
+    const size_t chunk = (count + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t) {
+        workers.emplace_back(work, std::min(count, t * chunk), std::min(count, (t + 1) * chunk));
+    }
+    work(0, std::min(count, chunk));
+    for (std::thread& worker : workers) worker.join();
+}
+
+// 21 bits per axis, enough for a million cells across the mesh
+uint64_t cellKey(const glm::ivec3 cell) {
+    return uint64_t(cell.x & 0x1FFFFF) << 42 | uint64_t(cell.y & 0x1FFFFF) << 21 | uint64_t(cell.z & 0x1FFFFF);
+}
+
+CleanupStats cleanMesh(std::vector<glm::vec3>& vertices, std::vector<glm::ivec3>& triangles, const float tolerance) {
+    const auto start = std::chrono::steady_clock::now();
+    CleanupStats stats;
+    const size_t numVertices = vertices.size();
+    const size_t numTriangles = triangles.size();
+    if (numVertices == 0) return stats;
+
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (const glm::vec3& v : vertices) {
+        lo = glm::min(lo, v);
+        hi = glm::max(hi, v);
+    }
+    const float diagonal = glm::length(hi - lo);
+    const float radius = tolerance * diagonal;
+    // cells never finer than a millionth of the mesh, so keys fit their 21 bits
+    const float cellSize = std::max({radius, diagonal * 1e-6f, 1e-30f});
+
+    // vertices sorted by grid cell, a cell's vertices are then one range found by binary search
+    std::vector<std::pair<uint64_t, int>> grid(numVertices);
+    cleanupChunks(numVertices, 8192, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            grid[i] = {cellKey(glm::ivec3((vertices[i] - lo) / cellSize)), int(i)};
+        }
+    });
+    std::sort(grid.begin(), grid.end());
+
+    // each vertex finds the first vertex within the radius in its own and the neighbouring cells
+    std::vector<int> first(numVertices);
+    cleanupChunks(numVertices, 4096, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3 p = vertices[i];
+            const glm::ivec3 cell((p - lo) / cellSize);
+            int found = int(i);
+            for (int dz = -1; dz <= 1; ++dz) {
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        const uint64_t key = cellKey(cell + glm::ivec3(dx, dy, dz));
+                        auto entry = std::lower_bound(grid.begin(), grid.end(), std::make_pair(key, 0));
+                        for (; entry != grid.end() && entry->first == key && entry->second < found; ++entry) {
+                            if (glm::distance(vertices[entry->second], p) <= radius) found = entry->second;
+                        }
+                    }
+                }
+            }
+            first[i] = found;
+        }
+    });
+    // first[i] <= i, so a forward pass resolves chains to the vertex that starts them
+    for (size_t i = 0; i < numVertices; ++i) {
+        if (first[i] != int(i)) {
+            first[i] = first[first[i]];
+            stats.weldedVertices++;
+        }
+    }
+    std::vector<std::pair<uint64_t, int>>().swap(grid);
+
+    // welded indices, then which triangles collapsed
+    const float minArea = 1e-12f * diagonal * diagonal;
+    std::vector<char> keep(numTriangles);
+    std::vector<std::array<int, 4>> sorted(numTriangles);
+    cleanupChunks(numTriangles, 8192, [&](const size_t begin, const size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            glm::ivec3& tri = triangles[t];
+            tri = glm::ivec3(first[tri.x], first[tri.y], first[tri.z]);
+            const glm::vec3 normal = glm::cross(vertices[tri.y] - vertices[tri.x], vertices[tri.z] - vertices[tri.x]);
+            keep[t] = tri.x != tri.y && tri.y != tri.z && tri.x != tri.z && glm::length(normal) > minArea;
+            std::array<int, 4> key = {tri.x, tri.y, tri.z, int(t)};
+            std::sort(key.begin(), key.begin() + 3);
+            sorted[t] = key;
+        }
+    });
+    for (size_t t = 0; t < numTriangles; ++t) stats.degenerateTriangles += !keep[t];
+
+    // same three vertices as an earlier kept triangle
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t s = 0, previous = SIZE_MAX; s < numTriangles; ++s) {
+        const int t = sorted[s][3];
+        if (!keep[t]) continue;
+        if (previous != SIZE_MAX && std::equal(sorted[s].begin(), sorted[s].begin() + 3, sorted[previous].begin())) {
+            keep[t] = 0;
+            stats.duplicateTriangles++;
+            continue;
+        }
+        previous = s;
+    }
+
+    std::vector<int> remap(numVertices, -1);
+    size_t kept = 0;
+    for (size_t t = 0; t < numTriangles; ++t) {
+        if (!keep[t]) continue;
+        for (int k = 0; k < 3; ++k) remap[triangles[t][k]] = 0;
+        triangles[kept++] = triangles[t];
+    }
+    triangles.resize(kept);
+
+    size_t used = 0;
+    for (size_t i = 0; i < numVertices; ++i) {
+        if (remap[i] < 0) continue;
+        remap[i] = int(used);
+        vertices[used++] = vertices[i];
+    }
+    stats.unusedVertices = int(numVertices - used) - stats.weldedVertices;
+    vertices.resize(used);
+    vertices.shrink_to_fit();
+    triangles.shrink_to_fit();
+    cleanupChunks(kept, 8192, [&](const size_t begin, const size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            triangles[t] = glm::ivec3(remap[triangles[t].x], remap[triangles[t].y], remap[triangles[t].z]);
+        }
+    });
+
+    stats.bytesSaved = (numVertices - used) * sizeof(glm::vec3) + (numTriangles - kept) * sizeof(glm::ivec3);
+    std::cout << "Cleanup: welded " << stats.weldedVertices << " and dropped " << stats.unusedVertices
+              << " unused vertices, dropped " << stats.degenerateTriangles << " degenerate and "
+              << stats.duplicateTriangles << " duplicate triangles, " << stats.bytesSaved / 1024.0 << " KB saved in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms"
+              << std::endl;
+    return stats;
+}
@@ -0,0 +1,29 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef MESHCLEANUP_H
+#define MESHCLEANUP_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+struct CleanupStats {
+    int weldedVertices = 0;
+    int unusedVertices = 0;
+    int degenerateTriangles = 0;
+    int duplicateTriangles = 0;
+    size_t bytesSaved = 0;
+};
+
+// Cleans a mesh before the BVH build, in place. Vertices closer than
+// tolerance times the mesh's bounding box diagonal are welded to the first of
+// them, found through a hash grid of that cell size. Triangles left with a
+// repeated vertex or zero area are dropped, as are triangles over the same
+// three vertices as an earlier one in either winding, and then the vertices
+// no triangle uses. Surviving vertices and triangles keep their order. The
+// searches and per triangle tests are spread over the hardware threads.
+CleanupStats cleanMesh(std::vector<glm::vec3>& vertices, std::vector<glm::ivec3>& triangles, float tolerance);
+
+#endif //MESHCLEANUP_H
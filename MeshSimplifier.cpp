@@ -0,0 +1,316 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <queue>
+
+// symmetric 4x4 plane quadric, the upper triangle row by row
+struct Quadric {
+    double q[10] = {};
+
+    void addPlane(const glm::dvec3 n, const double d, const double weight) {
+        q[0] += weight * n.x * n.x; q[1] += weight * n.x * n.y; q[2] += weight * n.x * n.z; q[3] += weight * n.x * d;
+        q[4] += weight * n.y * n.y; q[5] += weight * n.y * n.z; q[6] += weight * n.y * d;
+        q[7] += weight * n.z * n.z; q[8] += weight * n.z * d;
+        q[9] += weight * d * d;
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        for (int i = 0; i < 10; ++i) q[i] += other.q[i];
+        return *this;
+    }
+
+    [[nodiscard]] double cost(const glm::dvec3 v) const {
+        return q[0] * v.x * v.x + 2 * q[1] * v.x * v.y + 2 * q[2] * v.x * v.z + 2 * q[3] * v.x
+             + q[4] * v.y * v.y + 2 * q[5] * v.y * v.z + 2 * q[6] * v.y
+             + q[7] * v.z * v.z + 2 * q[8] * v.z + q[9];
+    }
+
+    // the point of least cost, false when the planes don't pin one down
+    bool optimum(glm::dvec3& v) const {
+        const glm::dmat3 a(q[0], q[1], q[2], q[1], q[4], q[5], q[2], q[5], q[7]);
+        const double det = glm::determinant(a);
+        if (std::abs(det) < 1e-12 * std::max(1.0, q[0] * q[4] * q[7])) return false;
+        v = glm::inverse(a) * -glm::dvec3(q[3], q[6], q[8]);
+        return true;
+    }
+};
+
+// distance from p to the closest point of triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+double pointTriangleDistance(const glm::dvec3 p, const glm::dvec3 a, const glm::dvec3 b, const glm::dvec3 c) {
+    const glm::dvec3 ab = b - a, ac = c - a, ap = p - a;
+    const double d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0) return glm::length(ap);
+    const glm::dvec3 bp = p - b;
+    const double d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3) return glm::length(bp);
+    const double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) return glm::length(ap - ab * (d1 / (d1 - d3)));
+    const glm::dvec3 cp = p - c;
+    const double d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6) return glm::length(cp);
+    const double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) return glm::length(ap - ac * (d2 / (d2 - d6)));
+    const double va = d3 * d6 - d5 * d4;
+    if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) return glm::length(bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+    const double denom = 1 / (va + vb + vc);
+    return glm::length(ap - ab * (vb * denom) - ac * (vc * denom));
+}
+
+struct QuadricSimplifier {
+    // boundary planes weigh this much more than the triangles next to them
+    static constexpr double BOUNDARY_WEIGHT = 10;
+
+    struct Collapse {
+        double cost;
+        int a, b;
+        int stampA, stampB;
+        glm::dvec3 position;
+
+        bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    std::vector<glm::dvec3> positions;
+    // the input positions, and the vertex each one was merged into (itself while it lives)
+    std::vector<glm::dvec3> original;
+    std::vector<int> mergedInto;
+    std::vector<Quadric> quadrics;
+    // bumped whenever a vertex moves, -1 once it was merged away, so queued collapses can tell they are stale
+    std::vector<int> stamps;
+    std::vector<glm::ivec3> triangles;
+    std::vector<char> alive;
+    std::vector<std::vector<int>> vertexTriangles;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> queue;
+    int live = 0;
+
+    QuadricSimplifier(const std::vector<glm::vec3>& vertices, const std::vector<glm::ivec3>& input) {
+        positions.assign(vertices.begin(), vertices.end());
+        original = positions;
+        mergedInto.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) mergedInto[i] = int(i);
+        quadrics.resize(vertices.size());
+        stamps.assign(vertices.size(), 0);
+        vertexTriangles.resize(vertices.size());
+        triangles.reserve(input.size());
+        for (const glm::ivec3 tri : input) {
+            if (tri.x == tri.y || tri.y == tri.z || tri.x == tri.z) continue;
+            triangles.push_back(tri);
+        }
+        alive.assign(triangles.size(), 1);
+        live = int(triangles.size());
+
+        // edges as (low, high, triangle), sorted so each edge's triangles are adjacent
+        std::vector<glm::ivec3> edges;
+        edges.reserve(triangles.size() * 3);
+        for (int t = 0; t < int(triangles.size()); ++t) {
+            const glm::ivec3 tri = triangles[t];
+            const glm::dvec3 p0 = positions[tri.x];
+            const glm::dvec3 cross = glm::cross(positions[tri.y] - p0, positions[tri.z] - p0);
+            const double length = glm::length(cross);
+            if (length > 0) {
+                const glm::dvec3 n = cross / length;
+                Quadric plane;
+                plane.addPlane(n, -glm::dot(n, p0), length * 0.5);
+                for (int k = 0; k < 3; ++k) quadrics[tri[k]] += plane;
+            }
+            for (int k = 0; k < 3; ++k) {
+                vertexTriangles[tri[k]].push_back(t);
+                const int u = tri[k], v = tri[(k + 1) % 3];
+                edges.emplace_back(std::min(u, v), std::max(u, v), t);
+            }
+        }
+        std::sort(edges.begin(), edges.end(), [](const glm::ivec3& a, const glm::ivec3& b) {
+            return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+        });
+
+        for (size_t i = 0; i < edges.size();) {
+            size_t end = i + 1;
+            while (end < edges.size() && edges[end].x == edges[i].x && edges[end].y == edges[i].y) end++;
+            if (end - i == 1) addBoundary(edges[i].x, edges[i].y, edges[i].z);
+            i = end;
+        }
+        for (size_t i = 0; i < edges.size(); ++i) {
+            if (i > 0 && edges[i].x == edges[i - 1].x && edges[i].y == edges[i - 1].y) continue;
+            push(edges[i].x, edges[i].y);
+        }
+    }
+
+    // a plane through the edge, perpendicular to its only triangle, on both of its vertices
+    void addBoundary(const int u, const int v, const int t) {
+        const glm::ivec3 tri = triangles[t];
+        const glm::dvec3 p0 = positions[tri.x];
+        const glm::dvec3 normal = glm::cross(positions[tri.y] - p0, positions[tri.z] - p0);
+        const glm::dvec3 edge = positions[v] - positions[u];
+        const glm::dvec3 across = glm::cross(edge, normal);
+        const double length = glm::length(across);
+        if (length <= 0) return;
+        const glm::dvec3 n = across / length;
+        Quadric plane;
+        plane.addPlane(n, -glm::dot(n, positions[u]), BOUNDARY_WEIGHT * glm::dot(edge, edge));
+        quadrics[u] += plane;
+        quadrics[v] += plane;
+    }
+
+    void push(const int a, const int b) {
+        Quadric sum = quadrics[a];
+        sum += quadrics[b];
+        const glm::dvec3 pa = positions[a], pb = positions[b];
+        glm::dvec3 best = (pa + pb) * 0.5;
+        double bestCost = sum.cost(best);
+        const glm::dvec3 candidates[2] = {pa, pb};
+        for (const glm::dvec3 candidate : candidates) {
+            const double cost = sum.cost(candidate);
+            if (cost < bestCost) {
+                best = candidate;
+                bestCost = cost;
+            }
+        }
+        // an optimum far off the edge means nearly parallel planes, not a better place
+        glm::dvec3 optimum;
+        if (sum.optimum(optimum) && glm::length(optimum - (pa + pb) * 0.5) <= glm::length(pb - pa)) {
+            const double cost = sum.cost(optimum);
+            if (cost < bestCost) {
+                best = optimum;
+                bestCost = cost;
+            }
+        }
+        queue.push({std::max(bestCost, 0.0), a, b, stamps[a], stamps[b], best});
+    }
+
+    // whether moving vertex to position turns any of its triangles not shared with other over or flat
+    [[nodiscard]] bool flips(const int vertex, const int other, const glm::dvec3 position) const {
+        for (const int t : vertexTriangles[vertex]) {
+            if (!alive[t]) continue;
+            const glm::ivec3 tri = triangles[t];
+            if (tri.x == other || tri.y == other || tri.z == other) continue;
+            glm::dvec3 p[3] = {positions[tri.x], positions[tri.y], positions[tri.z]};
+            const glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            for (int k = 0; k < 3; ++k) {
+                if (tri[k] == vertex) p[k] = position;
+            }
+            const glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+            if (glm::dot(before, after) <= 1e-3 * glm::length(before) * glm::length(after)) return true;
+        }
+        return false;
+    }
+
+    // b is merged into a
+    void collapse(const Collapse& c) {
+        const int a = c.a, b = c.b;
+        positions[a] = c.position;
+        quadrics[a] += quadrics[b];
+        stamps[a]++;
+        stamps[b] = -1;
+        mergedInto[b] = a;
+
+        for (const int t : vertexTriangles[b]) {
+            if (!alive[t]) continue;
+            glm::ivec3& tri = triangles[t];
+            if (tri.x == a || tri.y == a || tri.z == a) {
+                alive[t] = 0;
+                live--;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                if (tri[k] == b) tri[k] = a;
+            }
+            vertexTriangles[a].push_back(t);
+        }
+        std::vector<int>().swap(vertexTriangles[b]);
+        std::vector<int>& around = vertexTriangles[a];
+        around.erase(std::remove_if(around.begin(), around.end(), [&](const int t) { return !alive[t]; }), around.end());
+
+        // every edge at a changed cost, each neighbour once
+        std::vector<int> neighbours;
+        for (const int t : around) {
+            for (int k = 0; k < 3; ++k) {
+                if (triangles[t][k] != a) neighbours.push_back(triangles[t][k]);
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        for (const int u : neighbours) push(a, u);
+    }
+
+    // collapses until at most target triangles are left, false if it ran out of collapses first
+    bool reduce(const int target) {
+        while (live > target) {
+            if (queue.empty()) return false;
+            const Collapse c = queue.top();
+            queue.pop();
+            if (stamps[c.a] != c.stampA || stamps[c.b] != c.stampB) continue;
+            if (flips(c.a, c.b, c.position) || flips(c.b, c.a, c.position)) continue;
+            collapse(c);
+        }
+        return true;
+    }
+
+    // Largest distance from an input vertex to the triangles around the vertex it was merged
+    // into. Quadric costs only measure distance to the input planes, which misses how far a
+    // coarse face cuts through a curved surface; this catches it. The closest triangle may
+    // lie elsewhere, so it can only overestimate the true distance.
+    [[nodiscard]] double surfaceError() {
+        double error = 0;
+        for (size_t i = 0; i < original.size(); ++i) {
+            int vertex = int(i);
+            while (mergedInto[vertex] != vertex) vertex = mergedInto[vertex];
+            // shortened paths keep later snapshots from walking whole merge chains again
+            mergedInto[i] = vertex;
+            double closest = -1;
+            for (const int t : vertexTriangles[vertex]) {
+                if (!alive[t]) continue;
+                const glm::ivec3 tri = triangles[t];
+                const double distance = pointTriangleDistance(original[i], positions[tri.x], positions[tri.y], positions[tri.z]);
+                if (closest < 0 || distance < closest) closest = distance;
+            }
+            error = std::max(error, closest);
+        }
+        return error;
+    }
+
+    [[nodiscard]] SimplifiedMesh snapshot() {
+        SimplifiedMesh mesh;
+        mesh.error = float(surfaceError());
+        std::vector<int> remap(positions.size(), -1);
+        mesh.triangles.reserve(live);
+        for (size_t t = 0; t < triangles.size(); ++t) {
+            if (!alive[t]) continue;
+            glm::ivec3 tri = triangles[t];
+            for (int k = 0; k < 3; ++k) {
+                int& index = remap[tri[k]];
+                if (index < 0) {
+                    index = int(mesh.vertices.size());
+                    mesh.vertices.emplace_back(positions[tri[k]]);
+                }
+                tri[k] = index;
+            }
+            mesh.triangles.push_back(tri);
+        }
+        return mesh;
+    }
+};
+
+std::vector<SimplifiedMesh> simplifyMesh(const std::vector<glm::vec3>& vertices, const std::vector<glm::ivec3>& triangles,
+                                         const std::vector<int>& targets) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<SimplifiedMesh> meshes;
+    QuadricSimplifier simplifier(vertices, triangles);
+    for (const int target : targets) {
+        const int before = simplifier.live;
+        const bool reached = simplifier.reduce(target);
+        // a level that barely differs from the last is not worth its memory
+        if (simplifier.live > before * 9 / 10) break;
+        meshes.push_back(simplifier.snapshot());
+        std::cout << "LOD " << meshes.size() << ": " << simplifier.live << " triangles, error " << meshes.back().error << std::endl;
+        if (!reached) break;
+    }
+    std::cout << "Simplified " << triangles.size() << " triangles into " << meshes.size() << " levels in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+    return meshes;
+}
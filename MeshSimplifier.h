@@ -0,0 +1,33 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+struct SimplifiedMesh {
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::ivec3> triangles;
+    // largest distance from an input vertex to this mesh's surface, in mesh units
+    float error = 0;
+};
+
+// Quadric error edge collapse (Garland and Heckbert 1997). Every vertex keeps
+// the area weighted quadric of its triangles' planes, boundary edges add a
+// heavier plane across them so open borders stay in place. The cheapest edge
+// is always collapsed next, to the position minimizing the summed quadric or,
+// when that is ill-conditioned, the better of its ends and midpoint; collapses
+// that would flip a triangle are skipped. A mesh's error is measured from every
+// input vertex to the triangles around the vertex it ended up merged into,
+// which bounds how far the simplified surface strays from the input.
+//
+// One pass goes down to the smallest target and copies the mesh out as it
+// passes each one, so targets are triangle counts from largest to smallest.
+// Meshes that run out of collapses before a target end the chain early.
+std::vector<SimplifiedMesh> simplifyMesh(const std::vector<glm::vec3>& vertices, const std::vector<glm::ivec3>& triangles,
+                                         const std::vector<int>& targets);
+
+#endif //MESHSIMPLIFIER_H
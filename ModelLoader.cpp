@@ -0,0 +1,184 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "ModelLoader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using LoaderClock = std::chrono::steady_clock;
+
+double msSince(const LoaderClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(LoaderClock::now() - start).count();
+}
+
+bool readSceneFile(const std::string& filename, std::vector<ModelInstance>& instances, std::vector<SphereGroup>& spheres) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream words(line);
+        std::string type;
+        if (!(words >> type) || type[0] == '#') continue;
+
+        if (type == "model") {
+            ModelInstance instance{};
+            if (!(words >> instance.filename
+                        >> instance.position.x >> instance.position.y >> instance.position.z
+                        >> instance.scale.x >> instance.scale.y >> instance.scale.z
+                        >> instance.color.x >> instance.color.y >> instance.color.z
+                        >> instance.smoothness >> instance.emission)) {
+                std::cerr << "Bad model line in " << filename << ": " << line << std::endl;
+                return false;
+            }
+            instances.push_back(instance);
+        } else if (type == "sphere") {
+            glm::vec4 sphere;
+            SphereGroup material{};
+            if (!(words >> sphere.x >> sphere.y >> sphere.z >> sphere.w
+                        >> material.color.x >> material.color.y >> material.color.z
+                        >> material.smoothness >> material.emission)) {
+                std::cerr << "Bad sphere line in " << filename << ": " << line << std::endl;
+                return false;
+            }
+            const auto group = std::find_if(spheres.begin(), spheres.end(), [&](const SphereGroup& g) {
+                return g.color == material.color && g.smoothness == material.smoothness && g.emission == material.emission;
+            });
+            if (group != spheres.end()) {
+                group->spheres.push_back(sphere);
+            } else {
+                material.spheres.push_back(sphere);
+                spheres.push_back(std::move(material));
+            }
+        } else {
+            std::cerr << "Unknown entry in " << filename << ": " << line << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+ModelLoader::~ModelLoader() {
+    join();
+}
+
+void ModelLoader::begin(const std::vector<ModelInstance>& instances, const BuildOptions& options) {
+    this->instances = instances;
+    buildOptions = options;
+    files.clear();
+    for (const ModelInstance& instance : instances) {
+        if (std::find(files.begin(), files.end(), instance.filename) == files.end()) {
+            files.push_back(instance.filename);
+        }
+    }
+    remaining = int(files.size());
+    start = LoaderClock::now();
+    // scenes of only spheres have nothing to load, and no parser would be left to close the queues
+    if (files.empty()) return;
+
+    // BVH building dominates, so most of the cores go to the builders
+    const int cores = std::max(2u, std::thread::hardware_concurrency());
+    const int parsers = std::clamp(cores / 4, 1, std::max(1, int(files.size())));
+    const int builders = std::clamp(cores - parsers - 1, 1, std::max(1, int(files.size())));
+
+    activeParsers = parsers;
+    activeBuilders = builders;
+    threads.emplace_back(&ModelLoader::readLoop, this);
+    for (int i = 0; i < parsers; ++i) threads.emplace_back(&ModelLoader::parseLoop, this);
+    for (int i = 0; i < builders; ++i) threads.emplace_back(&ModelLoader::buildLoop, this);
+}
+
+void ModelLoader::readLoop() {
+    for (const std::string& filename : files) {
+        const auto t = LoaderClock::now();
+        auto job = std::make_unique<Job>();
+        job->filename = filename;
+        job->buffer = BaseModel::readFile(filename);
+        job->readMs = msSince(t);
+        toParse.push(std::move(job));
+    }
+    toParse.close();
+}
+
+void ModelLoader::parseLoop() {
+    std::unique_ptr<Job> job;
+    while (toParse.pop(job)) {
+        const auto t = LoaderClock::now();
+        if (!job->buffer.empty()) BaseModel::parse(job->buffer, job->vertices, job->triangles);
+        job->buffer = std::vector<char>();
+        job->parseMs = msSince(t);
+        toBuild.push(std::move(job));
+    }
+    if (--activeParsers == 0) toBuild.close();
+}
+
+void ModelLoader::buildLoop() {
+    std::unique_ptr<Job> job;
+    while (toBuild.pop(job)) {
+        const auto t = LoaderClock::now();
+        job->model.filename = job->filename;
+        if (!job->triangles.empty()) job->model.build(job->vertices, job->triangles, buildOptions);
+        job->vertices = std::vector<glm::vec3>();
+        job->triangles = std::vector<glm::ivec3>();
+        job->buildMs = msSince(t);
+        done.push(std::move(job));
+    }
+    if (--activeBuilders == 0) done.close();
+}
+
+int ModelLoader::poll(Scene& scene, const bool wait) {
+    int added = 0;
+    std::unique_ptr<Job> job;
+    bool have = remaining > 0 && (wait ? done.pop(job) : done.tryPop(job));
+    while (have) {
+        remaining--;
+        stageMs[0] += job->readMs;
+        stageMs[1] += job->parseMs;
+        stageMs[2] += job->buildMs;
+        std::cout << "Loaded " << job->filename << " at " << msSince(start) << " ms (read " << job->readMs
+                  << ", parse " << job->parseMs << ", build " << job->buildMs << ")" << std::endl;
+
+        if (!job->model.triangles.empty()) {
+            // the last instance of a file can take the model over unless the scene wants copies
+            int uses = 0;
+            for (const ModelInstance& instance : instances) uses += instance.filename == job->filename;
+            const bool move = scene.getGeometryMode() != GeometryMode::Retained;
+            for (const ModelInstance& instance : instances) {
+                if (instance.filename != job->filename) continue;
+                if (--uses == 0 && move) {
+                    scene.addModel(std::move(job->model), instance.position, instance.scale, instance.color, instance.smoothness, instance.emission);
+                } else {
+                    scene.addModel(job->model, instance.position, instance.scale, instance.color, instance.smoothness, instance.emission);
+                }
+                added++;
+            }
+        }
+
+        have = done.tryPop(job);
+    }
+
+    if (remaining == 0 && !threads.empty()) {
+        join();
+        std::cout << "All models loaded in " << msSince(start) << " ms (stage totals: read " << stageMs[0]
+                  << ", parse " << stageMs[1] << ", build " << stageMs[2] << ")" << std::endl;
+    }
+    return added;
+}
+
+bool ModelLoader::finished() const {
+    return remaining == 0;
+}
+
+void ModelLoader::join() {
+    for (std::thread& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+    threads.clear();
+}
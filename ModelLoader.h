@@ -0,0 +1,95 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BaseModel.h"
+#include "Scene.h"
+#include "WorkQueue.h"
+
+struct ModelInstance {
+    std::string filename;
+    glm::vec3 position;
+    glm::vec3 scale;
+    glm::vec3 color;
+    float smoothness;
+    float emission;
+};
+
+// spheres with one material, added to the scene as one SphereSet
+struct SphereGroup {
+    std::vector<glm::vec4> spheres;
+    glm::vec3 color;
+    float smoothness;
+    float emission;
+};
+
+// Scene file: one instance or analytic sphere per line,
+//   model <file> px py pz sx sy sz r g b smoothness emission
+//   sphere px py pz radius r g b smoothness emission
+// Spheres sharing a material are grouped into one set. '#' starts a comment.
+bool readSceneFile(const std::string& filename, std::vector<ModelInstance>& instances, std::vector<SphereGroup>& spheres);
+
+// Staged model loading: an I/O thread reads files, parser threads tokenize
+// them and builder threads construct the BVHs, all overlapping. The GL
+// thread picks finished models up with poll() and adds every instance that
+// uses them, so the first frame can show up before the last model is built.
+// Each file is loaded once no matter how many instances reference it.
+class ModelLoader {
+    struct Job {
+        std::string filename;
+        std::vector<char> buffer;
+        std::vector<glm::vec3> vertices;
+        std::vector<glm::ivec3> triangles;
+        BaseModel model;
+        double readMs = 0, parseMs = 0, buildMs = 0;
+    };
+
+    std::vector<ModelInstance> instances;
+    std::vector<std::string> files;
+    BuildOptions buildOptions;
+
+    WorkQueue<std::unique_ptr<Job>> toParse{4};
+    WorkQueue<std::unique_ptr<Job>> toBuild{4};
+    WorkQueue<std::unique_ptr<Job>> done;
+    std::atomic<int> activeParsers{0};
+    std::atomic<int> activeBuilders{0};
+    std::vector<std::thread> threads;
+
+    int remaining = 0;
+    double stageMs[3] = {};
+    std::chrono::steady_clock::time_point start;
+
+    void readLoop();
+
+    void parseLoop();
+
+    void buildLoop();
+
+    public:
+    ModelLoader() = default;
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+    ~ModelLoader();
+
+    void begin(const std::vector<ModelInstance>& instances, const BuildOptions& options = {});
+
+    // GL thread: adds the instances of every model finished since the last
+    // call (waiting for at least one when wait is set), returns how many were added
+    int poll(Scene& scene, bool wait);
+
+    [[nodiscard]] bool finished() const;
+
+    void join();
+};
+
+#endif //MODELLOADER_H
@@ -0,0 +1,200 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "PLOCBuilder.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+float clusterArea(const glm::vec3 min, const glm::vec3 max) {
+    const glm::vec3 size = glm::max(max - min, glm::vec3(0));
+    return size.x * (size.y + size.z) + size.y * size.z;
+}
+
+// spreads the low 10 bits of v so two zero bits follow each one
+glm::uint expandBits(glm::uint v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+PLOCBuilder::PLOCBuilder(BaseModel& model) : model(model) {}
+
+std::vector<int> PLOCBuilder::sortByMorton() const {
+    glm::vec3 centroidMin(1e30f), centroidMax(-1e30f);
+    for (const Cluster& cluster : clusters) {
+        const glm::vec3 centroid = (cluster.min + cluster.max) * 0.5f;
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+    const glm::vec3 scale = 1023.0f / glm::max(centroidMax - centroidMin, glm::vec3(1e-20f));
+
+    std::vector<std::pair<glm::uint, int>> codes(clusters.size());
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        const glm::uvec3 q = glm::uvec3(((clusters[i].min + clusters[i].max) * 0.5f - centroidMin) * scale);
+        codes[i] = {expandBits(q.x) << 2 | expandBits(q.y) << 1 | expandBits(q.z), int(i)};
+    }
+    std::sort(codes.begin(), codes.end());
+
+    std::vector<int> order(codes.size());
+    for (size_t i = 0; i < codes.size(); ++i) order[i] = codes[i].second;
+    return order;
+}
+
+void PLOCBuilder::merge(std::vector<int>& active) {
+    const int n = int(active.size());
+    std::vector<glm::vec3> boxMin(n), boxMax(n);
+    for (int i = 0; i < n; ++i) {
+        boxMin[i] = clusters[active[i]].min;
+        boxMax[i] = clusters[active[i]].max;
+    }
+
+    std::vector<int> nearest(n);
+    const auto search = [&](const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            int best = -1;
+            float bestArea = 1e30f;
+            for (int j = std::max(0, i - SEARCH_RADIUS); j <= std::min(n - 1, i + SEARCH_RADIUS); ++j) {
+                if (j == i) continue;
+                const float area = clusterArea(glm::min(boxMin[i], boxMin[j]), glm::max(boxMax[i], boxMax[j]));
+                if (area < bestArea) {
+                    bestArea = area;
+                    best = j;
+                }
+            }
+            nearest[i] = best;
+        }
+    };
+    // a thread per few thousand clusters, the last rounds are too small to be worth one
+    const int threads = std::clamp(n / 4096, 1, int(std::max(1u, std::thread::hardware_concurrency())));
+    const int chunk = (n + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(search, std::min(n, t * chunk), std::min(n, (t + 1) * chunk));
+    search(0, std::min(n, chunk));
+    for (std::thread& worker : workers) worker.join();
+
+    // mutual nearest neighbours merge, the new cluster takes the place of the first of the two
+    std::vector<int> next;
+    next.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        const int j = nearest[i];
+        if (nearest[j] != i) {
+            next.push_back(active[i]);
+            continue;
+        }
+        if (i > j) continue;
+        Cluster merged;
+        merged.min = glm::min(boxMin[i], boxMin[j]);
+        merged.max = glm::max(boxMax[i], boxMax[j]);
+        merged.left = active[i];
+        merged.right = active[j];
+        merged.count = clusters[active[i]].count + clusters[active[j]].count;
+        next.push_back(int(clusters.size()));
+        clusters.push_back(merged);
+    }
+    // ties can leave no mutual pair, merging any two neighbours still makes progress
+    if (int(next.size()) == n) {
+        Cluster merged;
+        merged.min = glm::min(boxMin[0], boxMin[1]);
+        merged.max = glm::max(boxMax[0], boxMax[1]);
+        merged.left = active[0];
+        merged.right = active[1];
+        merged.count = clusters[active[0]].count + clusters[active[1]].count;
+        next.erase(next.begin(), next.begin() + 2);
+        next.insert(next.begin(), int(clusters.size()));
+        clusters.push_back(merged);
+    }
+    active.swap(next);
+}
+
+void PLOCBuilder::emit(const int root, const int rootIndex) {
+    // cluster and node index pairs, right pushed before left so nodes come out in the
+    // preorder a recursive emit would give, however deep the merge tree got
+    std::vector<std::pair<int, int>> work = {{root, rootIndex}};
+    while (!work.empty()) {
+        const auto [cluster, index] = work.back();
+        work.pop_back();
+        const Cluster& c = clusters[cluster];
+        if (collapse[cluster]) {
+            const int start = int(leafTriangles.size());
+            std::vector<int> stack = {cluster};
+            while (!stack.empty()) {
+                const Cluster& node = clusters[stack.back()];
+                stack.pop_back();
+                if (node.tri >= 0) {
+                    leafTriangles.push_back(model.triangles[node.tri]);
+                    continue;
+                }
+                stack.push_back(node.right);
+                stack.push_back(node.left);
+            }
+            model.boundingBoxMin[index] = glm::vec4(c.min, -start);
+            model.boundingBoxMax[index] = glm::vec4(c.max, -c.count);
+            continue;
+        }
+
+        const int childA = int(model.boundingBoxMin.size());
+        model.boundingBoxMin.resize(childA + 2);
+        model.boundingBoxMax.resize(childA + 2);
+        model.boundingBoxMin[index] = glm::vec4(c.min, childA);
+        model.boundingBoxMax[index] = glm::vec4(c.max, childA + 1);
+        work.emplace_back(c.right, childA + 1);
+        work.emplace_back(c.left, childA);
+    }
+}
+
+void PLOCBuilder::build() {
+    const int numTris = int(model.triangles.size());
+    model.boundingBoxMin.clear();
+    model.boundingBoxMax.clear();
+    if (numTris == 0) return;
+
+    clusters.clear();
+    clusters.reserve(size_t(numTris) * 2);
+    for (int i = 0; i < numTris; ++i) {
+        Cluster leaf;
+        glm::vec3 center;
+        model.triangleBounds(i, leaf.min, leaf.max, center);
+        leaf.tri = i;
+        clusters.push_back(leaf);
+    }
+
+    std::vector<int> active = sortByMorton();
+    int iterations = 0;
+    while (active.size() > 1) {
+        merge(active);
+        iterations++;
+    }
+
+    // children are created before their parents, so one forward sweep is bottom-up
+    collapse.assign(clusters.size(), 0);
+    cost.assign(clusters.size(), 0);
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        const Cluster& c = clusters[i];
+        const float area = clusterArea(c.min, c.max);
+        const float leafCost = area * float(c.count);
+        if (c.tri >= 0) {
+            collapse[i] = 1;
+            cost[i] = leafCost;
+            continue;
+        }
+        const float splitCost = area + cost[c.left] + cost[c.right];
+        collapse[i] = c.count <= MAX_LEAF_SIZE && leafCost <= splitCost;
+        cost[i] = collapse[i] ? leafCost : splitCost;
+    }
+
+    leafTriangles.clear();
+    leafTriangles.reserve(numTris);
+    model.boundingBoxMin.resize(1);
+    model.boundingBoxMax.resize(1);
+    emit(active[0], 0);
+    model.triangles = std::move(leafTriangles);
+
+    std::cout << "PLOC: " << numTris << " triangles, " << iterations << " iterations, "
+              << model.boundingBoxMin.size() << " nodes" << std::endl;
+    std::vector<Cluster>().swap(clusters);
+}
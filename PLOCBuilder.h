@@ -0,0 +1,54 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef PLOCBUILDER_H
+#define PLOCBUILDER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "BaseModel.h"
+
+// Bottom-up agglomerative builder (PLOC, Meister and Bittner 2018). Triangles
+// start as one cluster each, sorted along a Morton curve. Every iteration each
+// cluster finds the neighbour within SEARCH_RADIUS positions whose merged box
+// is smallest, and mutual nearest pairs merge, until one cluster is left. The
+// neighbour searches run on all hardware threads. The binary tree is then
+// collapsed bottom-up into leaves wherever a leaf is as cheap by SAH, and
+// written in the same node and leaf encoding as BaseModel::createBVH.
+class PLOCBuilder {
+    static constexpr int SEARCH_RADIUS = 16;
+    static constexpr int MAX_LEAF_SIZE = 16;
+
+    struct Cluster {
+        glm::vec3 min, max;
+        int left = -1, right = -1;
+        // first triangle for a single triangle cluster, otherwise -1
+        int tri = -1;
+        int count = 1;
+    };
+
+    BaseModel& model;
+    std::vector<Cluster> clusters;
+    // per cluster: whether it is written as one leaf, and its SAH cost
+    std::vector<char> collapse;
+    std::vector<float> cost;
+    // triangles in the order the leaves are written
+    std::vector<glm::ivec3> leafTriangles;
+
+    [[nodiscard]] std::vector<int> sortByMorton() const;
+
+    // one round of nearest neighbour search and merging over the active clusters
+    void merge(std::vector<int>& active);
+
+    // writes the nodes from root down, root itself at rootIndex
+    void emit(int root, int rootIndex);
+
+    public:
+    explicit PLOCBuilder(BaseModel& model);
+
+    // replaces the model's nodes and puts its triangles in leaf order
+    void build();
+};
+
+#endif //PLOCBUILDER_H
@@ -0,0 +1,451 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "PagedGeometry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+PagedGeometry::~PagedGeometry() {
+    unmap();
+}
+
+bool PagedGeometry::open(const std::string& path, const size_t budgetBytes) {
+    this->path = path;
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "Could not create page file " << path << std::endl;
+        return false;
+    }
+    fileBytes = 0;
+
+    stats.slots = int(std::max<size_t>(1, budgetBytes / SLOT_BYTES));
+    slotPages.assign(size_t(stats.slots), -1);
+    slotReached.assign(size_t(stats.slots), -1);
+    freeSlots.resize(size_t(stats.slots));
+    // popped from the back, so slot 0 is handed out first
+    for (int i = 0; i < stats.slots; ++i) freeSlots[size_t(i)] = stats.slots - 1 - i;
+
+    glGenBuffers(1, &nodeBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, nodeBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(size_t(stats.slots) * PAGE_NODES * 2 * sizeof(glm::vec4)), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, nodeBuffer);
+    glGenBuffers(1, &triangleBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, triangleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(size_t(stats.slots) * PAGE_TRIANGLES * 3 * sizeof(glm::vec4)), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 17, triangleBuffer);
+    std::cout << "Paging: " << stats.slots << " slots of " << (SLOT_BYTES >> 10) << " KB, pages in " << path << std::endl;
+    return true;
+}
+
+bool PagedGeometry::isOpen() const {
+    return nodeBuffer != 0;
+}
+
+void PagedGeometry::split(const BaseModel& model, const glm::vec3 position, const glm::vec3 scale, const int material,
+                          std::vector<glm::vec4>& nodeMin, std::vector<glm::vec4>& nodeMax) {
+    const std::vector<glm::vec4>& bboxMin = model.boundingBoxMin;
+    const std::vector<glm::vec4>& bboxMax = model.boundingBoxMax;
+
+    // subtree sizes from a preorder walked backwards, children before their parent
+    std::vector<int> order;
+    std::vector<int> stack = {0};
+    while (!stack.empty()) {
+        const int node = stack.back();
+        stack.pop_back();
+        order.push_back(node);
+        if (bboxMin[node].w <= 0) continue;
+        stack.push_back(int(bboxMin[node].w));
+        stack.push_back(int(bboxMax[node].w));
+    }
+    std::vector<int> nodes(bboxMin.size(), 1), triangles(bboxMin.size(), 0);
+    for (auto node = order.rbegin(); node != order.rend(); ++node) {
+        if (bboxMin[*node].w <= 0) {
+            triangles[*node] = -int(bboxMax[*node].w);
+            continue;
+        }
+        const int a = int(bboxMin[*node].w), b = int(bboxMax[*node].w);
+        nodes[*node] = 1 + nodes[a] + nodes[b];
+        triangles[*node] = triangles[a] + triangles[b];
+    }
+
+    // the resident tree breadth first, every subtree that fits a slot becomes a page
+    nodeMin.assign(1, glm::vec4(0));
+    nodeMax.assign(1, glm::vec4(0));
+    std::vector<std::pair<int, int>> work = {{0, 0}};
+    for (size_t i = 0; i < work.size(); ++i) {
+        const auto [node, index] = work[i];
+        glm::vec4 lo = bboxMin[node], hi = bboxMax[node];
+        lo *= glm::vec4(scale, 1);
+        lo += glm::vec4(position, 0);
+        hi *= glm::vec4(scale, 1);
+        hi += glm::vec4(position, 0);
+        if (nodes[node] <= PAGE_NODES && triangles[node] <= PAGE_TRIANGLES) {
+            nodeMin[index] = glm::vec4(glm::vec3(lo), -float(writePage(model, node, position, scale, material)));
+            nodeMax[index] = glm::vec4(glm::vec3(hi), 1);
+            continue;
+        }
+        if (bboxMin[node].w <= 0) {
+            splitLeaf(model, node, index, position, scale, material, nodeMin, nodeMax);
+            continue;
+        }
+        const int child = int(nodeMin.size());
+        nodeMin.resize(child + 2);
+        nodeMax.resize(child + 2);
+        nodeMin[index] = glm::vec4(glm::vec3(lo), float(child));
+        nodeMax[index] = glm::vec4(glm::vec3(hi), float(child + 1));
+        work.emplace_back(int(bboxMin[node].w), child);
+        work.emplace_back(int(bboxMax[node].w), child + 1);
+    }
+}
+
+// A leaf over PAGE_TRIANGLES (from --max-depth, or coincident triangles the SAH
+// won't split) can't be descended into; its triangles go out as slot-sized
+// pages of one leaf each, under a balanced resident tree of links.
+void PagedGeometry::splitLeaf(const BaseModel& model, const int leaf, const int index, const glm::vec3 position, const glm::vec3 scale,
+                              const int material, std::vector<glm::vec4>& nodeMin, std::vector<glm::vec4>& nodeMax) {
+    const int start = -int(model.boundingBoxMin[leaf].w), count = -int(model.boundingBoxMax[leaf].w);
+    const int chunks = (count + PAGE_TRIANGLES - 1) / PAGE_TRIANGLES;
+    std::vector<int> chunkPages(chunks);
+    std::vector<glm::vec3> chunkMin(chunks), chunkMax(chunks);
+    for (int c = 0; c < chunks; ++c) {
+        const int first = start + c * PAGE_TRIANGLES;
+        const int size = std::min(PAGE_TRIANGLES, start + count - first);
+        std::vector<glm::vec4> triangles;
+        appendTriangles(model, first, size, position, scale, material, triangles);
+        // from the placed vertices, v0 plus an edge can round to just inside them
+        glm::vec3 lo(1e30f), hi(-1e30f);
+        for (int t = first; t < first + size; ++t) {
+            for (int k = 0; k < 3; ++k) {
+                glm::vec3 v = model.vertices[model.triangles[t][k]];
+                v *= scale;
+                v += position;
+                lo = glm::min(lo, v);
+                hi = glm::max(hi, v);
+            }
+        }
+        chunkMin[size_t(c)] = lo;
+        chunkMax[size_t(c)] = hi;
+        chunkPages[size_t(c)] = addPage({glm::vec4(lo, 0), glm::vec4(hi, -float(triangles.size() / 3))}, triangles);
+    }
+
+    // node index and the range of chunks below it, halved down to single pages
+    std::vector<glm::ivec3> work = {{index, 0, chunks}};
+    while (!work.empty()) {
+        const glm::ivec3 item = work.back();
+        work.pop_back();
+        glm::vec3 lo(1e30f), hi(-1e30f);
+        for (int c = item.y; c < item.z; ++c) {
+            lo = glm::min(lo, chunkMin[size_t(c)]);
+            hi = glm::max(hi, chunkMax[size_t(c)]);
+        }
+        if (item.z - item.y == 1) {
+            nodeMin[size_t(item.x)] = glm::vec4(lo, -float(chunkPages[size_t(item.y)]));
+            nodeMax[size_t(item.x)] = glm::vec4(hi, 1);
+            continue;
+        }
+        const int child = int(nodeMin.size());
+        nodeMin.resize(child + 2);
+        nodeMax.resize(child + 2);
+        nodeMin[size_t(item.x)] = glm::vec4(lo, float(child));
+        nodeMax[size_t(item.x)] = glm::vec4(hi, float(child + 1));
+        const int middle = (item.y + item.z) / 2;
+        work.emplace_back(child, item.y, middle);
+        work.emplace_back(child + 1, middle, item.z);
+    }
+}
+
+void PagedGeometry::appendTriangles(const BaseModel& model, const int start, const int count, const glm::vec3 position, const glm::vec3 scale,
+                                    const int material, std::vector<glm::vec4>& triangles) {
+    const auto place = [&](glm::vec3 point) {
+        point *= scale;
+        point += position;
+        return point;
+    };
+    for (int t = start; t < start + count; ++t) {
+        const glm::ivec3 tri = model.triangles[t];
+        const glm::vec3 v0 = place(model.vertices[tri.x]);
+        triangles.emplace_back(v0, float(material));
+        triangles.emplace_back(place(model.vertices[tri.y]) - v0, 0);
+        triangles.emplace_back(place(model.vertices[tri.z]) - v0, 0);
+    }
+}
+
+// placed the same way Scene places resident geometry, so hits match it bit for bit
+int PagedGeometry::writePage(const BaseModel& model, const int root, const glm::vec3 position, const glm::vec3 scale, const int material) {
+    const std::vector<glm::vec4>& bboxMin = model.boundingBoxMin;
+    const std::vector<glm::vec4>& bboxMax = model.boundingBoxMax;
+    const auto place = [&](glm::vec3 point) {
+        point *= scale;
+        point += position;
+        return point;
+    };
+
+    std::vector<glm::vec4> nodes(2), triangles;
+    std::vector<std::pair<int, int>> work = {{root, 0}};
+    for (size_t i = 0; i < work.size(); ++i) {
+        const auto [node, index] = work[i];
+        const glm::vec3 lo = place(bboxMin[node]), hi = place(bboxMax[node]);
+        if (bboxMin[node].w <= 0) {
+            const int start = -int(bboxMin[node].w), count = -int(bboxMax[node].w);
+            const int local = int(triangles.size() / 3);
+            appendTriangles(model, start, count, position, scale, material, triangles);
+            nodes[index * 2 + 0] = glm::vec4(lo, -float(local));
+            nodes[index * 2 + 1] = glm::vec4(hi, -float(count));
+            continue;
+        }
+        const int child = int(nodes.size() / 2);
+        nodes.resize(nodes.size() + 4);
+        nodes[index * 2 + 0] = glm::vec4(lo, float(child));
+        nodes[index * 2 + 1] = glm::vec4(hi, float(child + 1));
+        work.emplace_back(int(bboxMin[node].w), child);
+        work.emplace_back(int(bboxMax[node].w), child + 1);
+    }
+    return addPage(nodes, triangles);
+}
+
+int PagedGeometry::addPage(const std::vector<glm::vec4>& nodes, const std::vector<glm::vec4>& triangles) {
+    Page page{fileBytes, int(nodes.size() / 2), int(triangles.size() / 3)};
+    const size_t nodeBytes = nodes.size() * sizeof(glm::vec4), triangleBytes = triangles.size() * sizeof(glm::vec4);
+    file.write(reinterpret_cast<const char*>(nodes.data()), std::streamsize(nodeBytes));
+    file.write(reinterpret_cast<const char*>(triangles.data()), std::streamsize(triangleBytes));
+    fileBytes += nodeBytes + triangleBytes;
+    pages.push_back(page);
+    table.emplace_back(-1, -1);
+    stats.pages = int(pages.size());
+    stats.triangles += triangles.size() / 3;
+    stats.fileBytes = fileBytes;
+    return int(pages.size()) - 1;
+}
+
+bool PagedGeometry::map() {
+    file.flush();
+    unmap();
+    if (fileBytes == 0) return false;
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        fileHandle = nullptr;
+        return false;
+    }
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle != nullptr) mapped = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+    descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+    void* view = mmap(nullptr, fileBytes, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (view != MAP_FAILED) mapped = static_cast<const char*>(view);
+#endif
+    if (mapped == nullptr) {
+        std::cout << "Could not map page file " << path << std::endl;
+        unmap();
+        return false;
+    }
+    mappedBytes = fileBytes;
+    return true;
+}
+
+void PagedGeometry::unmap() {
+#ifdef _WIN32
+    if (mapped != nullptr) UnmapViewOfFile(mapped);
+    if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+    if (fileHandle != nullptr) CloseHandle(fileHandle);
+    mappingHandle = fileHandle = nullptr;
+#else
+    if (mapped != nullptr) munmap(const_cast<char*>(mapped), mappedBytes);
+    if (descriptor >= 0) ::close(descriptor);
+    descriptor = -1;
+#endif
+    mapped = nullptr;
+    mappedBytes = 0;
+}
+
+size_t PagedGeometry::sync(StagingRing& staging) {
+    return tableBuffer.sync(table.data(), table.size() * sizeof(glm::ivec2), staging);
+}
+
+// takes in one finished readback: reached pages refresh their slot, missed ones are loaded later
+void PagedGeometry::read(Readback& readback) {
+    while (glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, readback.buffer);
+    const auto* entries = static_cast<const glm::ivec2*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, GLsizeiptr(readback.bytes), GL_MAP_READ_BIT));
+    if (entries == nullptr) return;
+    const size_t count = readback.bytes / sizeof(glm::ivec2);
+    for (size_t page = 0; page < count; ++page) {
+        const int reached = entries[page].y;
+        if (reached < 0) continue;
+        const int slot = table[page].x;
+        if (slot >= 0) {
+            slotReached[size_t(slot)] = std::max(slotReached[size_t(slot)], reached);
+        } else if (reached >= readback.frame) {
+            requests.push_back(int(page));
+        }
+    }
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+    latestFrame = std::max(latestFrame, readback.frame);
+}
+
+// Pages are small and land in scattered slots, so they go through glBufferSubData
+// straight from the mapping; a staging segment each would wait on the frame in flight
+int PagedGeometry::load(const int page, std::vector<int>& victims) {
+    int slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        if (victims.empty()) return -1;
+        slot = victims.back();
+        victims.pop_back();
+        const int evicted = slotPages[size_t(slot)];
+        table[size_t(evicted)].x = -1;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, tableBuffer.getBuffer());
+        glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(size_t(evicted) * sizeof(glm::ivec2)), sizeof(int), &table[size_t(evicted)].x);
+        stats.evictions++;
+    }
+
+    const Page& record = pages[size_t(page)];
+    const size_t nodeBytes = size_t(record.nodes) * 2 * sizeof(glm::vec4);
+    const size_t triangleBytes = size_t(record.triangles) * 3 * sizeof(glm::vec4);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, nodeBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(size_t(slot) * PAGE_NODES * 2 * sizeof(glm::vec4)), GLsizeiptr(nodeBytes), mapped + record.offset);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, triangleBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(size_t(slot) * PAGE_TRIANGLES * 3 * sizeof(glm::vec4)), GLsizeiptr(triangleBytes),
+                    mapped + record.offset + nodeBytes);
+
+    table[size_t(page)].x = slot;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, tableBuffer.getBuffer());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(size_t(page) * sizeof(glm::ivec2)), sizeof(int), &table[size_t(page)].x);
+    slotPages[size_t(slot)] = page;
+    slotReached[size_t(slot)] = latestFrame;
+    stats.loads++;
+    stats.loadedBytes += nodeBytes + triangleBytes;
+    return slot;
+}
+
+void PagedGeometry::grow(const int slots) {
+    const int old = stats.slots;
+    const struct {
+        GLuint& buffer;
+        GLuint binding;
+        size_t slotBytes;
+    } pools[] = {{nodeBuffer, 16, PAGE_NODES * 2 * sizeof(glm::vec4)}, {triangleBuffer, 17, PAGE_TRIANGLES * 3 * sizeof(glm::vec4)}};
+    for (const auto& pool : pools) {
+        GLuint larger;
+        glGenBuffers(1, &larger);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, larger);
+        glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(size_t(slots) * pool.slotBytes), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(size_t(old) * pool.slotBytes));
+        glDeleteBuffers(1, &pool.buffer);
+        pool.buffer = larger;
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, pool.binding, larger);
+    }
+
+    slotPages.resize(size_t(slots), -1);
+    slotReached.resize(size_t(slots), -1);
+    for (int slot = slots - 1; slot >= old; --slot) freeSlots.push_back(slot);
+    stats.slots = slots;
+    stats.grows++;
+    std::cout << "Paging: the view reaches more pages than the budget holds, growing the pool to " << slots << " slots ("
+              << double(size_t(slots) * SLOT_BYTES) / (1 << 20) << " MB)" << std::endl;
+}
+
+int PagedGeometry::update(const int frame, StagingRing& staging, const bool wait) {
+    if (!isOpen() || table.empty()) return 0;
+    const auto start = std::chrono::steady_clock::now();
+    sync(staging);
+
+    // the shader's table writes have to land before the copy reads them
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    Readback& queued = readbacks[nextReadback];
+    if (queued.fence != nullptr) read(queued);
+    const size_t bytes = table.size() * sizeof(glm::ivec2);
+    if (queued.buffer == 0) glGenBuffers(1, &queued.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, queued.buffer);
+    if (bytes > queued.bytes) glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(bytes), nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_COPY_READ_BUFFER, tableBuffer.getBuffer());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(bytes));
+    queued.bytes = bytes;
+    queued.frame = frame;
+    queued.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextReadback = (nextReadback + 1) % READBACK_RING;
+
+    // oldest first, stopping at the first one still in flight unless waiting for all
+    for (int i = 0; i < READBACK_RING; ++i) {
+        Readback& readback = readbacks[(nextReadback + i) % READBACK_RING];
+        if (readback.fence == nullptr) continue;
+        if (!wait && glClientWaitSync(readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break;
+        read(readback);
+    }
+
+    const size_t missed = requests.size();
+    std::sort(requests.begin(), requests.end());
+    requests.erase(std::unique(requests.begin(), requests.end()), requests.end());
+    stats.misses += missed;
+    if (requests.empty()) return 0;
+    if (mappedBytes < fileBytes && !map()) {
+        requests.clear();
+        return 0;
+    }
+
+    // eviction order: least recently reached first, never a page the latest frame still reached
+    std::vector<int> victims;
+    for (int slot = 0; slot < stats.slots; ++slot) {
+        if (slotPages[size_t(slot)] >= 0 && slotReached[size_t(slot)] < latestFrame) victims.push_back(slot);
+    }
+    std::sort(victims.begin(), victims.end(), [&](const int a, const int b) { return slotReached[size_t(a)] > slotReached[size_t(b)]; });
+
+    int loaded = 0;
+    for (size_t i = 0; i < requests.size() && loaded < MAX_LOADS_PER_UPDATE; ++i) {
+        const int page = requests[i];
+        if (table[size_t(page)].x >= 0) continue;
+        if (freeSlots.empty() && victims.empty()) {
+            // every slot holds a page the latest frame reached, so room for the rest of the requests at least
+            const int missing = int(std::min(requests.size() - i, size_t(MAX_LOADS_PER_UPDATE - loaded)));
+            grow(stats.slots + std::max(missing, stats.slots / 4));
+        }
+        if (load(page, victims) < 0) break;
+        loaded++;
+    }
+    requests.clear();
+    stats.loadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return loaded;
+}
+
+const PagingStats& PagedGeometry::getStats() const {
+    return stats;
+}
+
+size_t PagedGeometry::getGpuBytes() const {
+    return isOpen() ? size_t(stats.slots) * SLOT_BYTES + tableBuffer.getCapacity() : 0;
+}
+
+void PagedGeometry::release() {
+    for (Readback& readback : readbacks) {
+        if (readback.fence != nullptr) glDeleteSync(readback.fence);
+        if (readback.buffer != 0) glDeleteBuffers(1, &readback.buffer);
+        readback = Readback();
+    }
+    if (nodeBuffer != 0) glDeleteBuffers(1, &nodeBuffer);
+    if (triangleBuffer != 0) glDeleteBuffers(1, &triangleBuffer);
+    nodeBuffer = triangleBuffer = 0;
+    tableBuffer.release();
+    unmap();
+    file.close();
+}
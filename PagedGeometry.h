@@ -0,0 +1,164 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef PAGEDGEOMETRY_H
+#define PAGEDGEOMETRY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "BaseModel.h"
+#include "GpuBuffer.h"
+
+struct PagingStats {
+    int pages = 0;
+    size_t triangles = 0;
+    size_t fileBytes = 0;
+    int slots = 0;
+    int loads = 0;
+    int evictions = 0;
+    // times the pool outgrew the budget because one frame reached more pages than it holds
+    int grows = 0;
+    // page links rays reached while their page was not resident, summed over the frames read back
+    size_t misses = 0;
+    size_t loadedBytes = 0;
+    double loadMs = 0;
+};
+
+// Out-of-core geometry. split() keeps the top of a model's BVH for the
+// resident node arrays and cuts everything below into pages: subtrees of at
+// most PAGE_NODES nodes and PAGE_TRIANGLES triangles, written to one page
+// file in world space. A page is stored as its nodes (two vec4 each,
+// interleaved min then max, children and leaf starts relative to the page)
+// followed by its triangles as (v0, material), (e1, 0), (e2, 0), so it needs
+// no vertex or material lookups from outside. The resident tree reaches a
+// page through a link node, min.w = -page and max.w = 1, which no other node
+// kind has (leaves store -count in max.w). A leaf with more triangles than a
+// slot holds is paged in chunks under a few resident links instead.
+//
+// The GPU holds a fixed pool of page slots (bindings 16 and 17) sized by the
+// residency budget, and a table with per page its slot or -1 and the last
+// frame a ray reached its link (binding 18), which the PAGED shader variant
+// writes. update() copies the table back through a small fenced ring, so it
+// reads frames already finished without stalling, then loads the missed
+// pages from the memory-mapped file. When no slot is free the least recently
+// reached page is evicted, but never one reached in the frame just read back.
+// When every slot holds such a page the view needs more than the budget, and
+// evicting them would only trade one hole for another each frame, so the pool
+// grows past the budget with a warning instead.
+// Rays skip pages that are not resident yet, so geometry fills in over the
+// frames after the camera moves.
+class PagedGeometry {
+    public:
+    static constexpr int PAGE_NODES = 4096;
+    static constexpr int PAGE_TRIANGLES = 2048;
+    static constexpr size_t SLOT_BYTES = PAGE_NODES * 2 * sizeof(glm::vec4) + PAGE_TRIANGLES * 3 * sizeof(glm::vec4);
+
+    private:
+    // pages brought in per update(), each a pair of glBufferSubData calls straight from the mapping
+    static constexpr int MAX_LOADS_PER_UPDATE = 64;
+    static constexpr int READBACK_RING = 3;
+
+    struct Page {
+        size_t offset;
+        int nodes, triangles;
+    };
+    std::vector<Page> pages;
+    // per page: x slot or -1, y last frame a ray reached it (written by the shader)
+    std::vector<glm::ivec2> table;
+    std::vector<int> slotPages;
+    std::vector<int> slotReached;
+    std::vector<int> freeSlots;
+
+    std::string path;
+    std::ofstream file;
+    size_t fileBytes = 0;
+    const char* mapped = nullptr;
+    size_t mappedBytes = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int descriptor = -1;
+#endif
+
+    GLuint nodeBuffer = 0;
+    GLuint triangleBuffer = 0;
+    GpuBuffer tableBuffer{18};
+    struct Readback {
+        GLuint buffer = 0;
+        size_t bytes = 0;
+        GLsync fence = nullptr;
+        int frame = -1;
+    };
+    Readback readbacks[READBACK_RING];
+    int nextReadback = 0;
+    // last frame read back, pages reached in it are kept
+    int latestFrame = -1;
+    // missed pages read back since the last load
+    std::vector<int> requests;
+    PagingStats stats;
+
+    // appends the subtree under root as a page and returns its index
+    int writePage(const BaseModel& model, int root, glm::vec3 position, glm::vec3 scale, int material);
+
+    // pages a leaf too large for one slot in chunks, with resident links to them from index down
+    void splitLeaf(const BaseModel& model, int leaf, int index, glm::vec3 position, glm::vec3 scale, int material,
+                   std::vector<glm::vec4>& nodeMin, std::vector<glm::vec4>& nodeMax);
+
+    // placed triangles in the page encoding
+    static void appendTriangles(const BaseModel& model, int start, int count, glm::vec3 position, glm::vec3 scale, int material,
+                                std::vector<glm::vec4>& triangles);
+
+    // writes a page to the file and adds its table entry, returns its index
+    int addPage(const std::vector<glm::vec4>& nodes, const std::vector<glm::vec4>& triangles);
+
+    // maps the file up to everything written so far
+    bool map();
+
+    void unmap();
+
+    void read(Readback& readback);
+
+    // puts page in a free slot or the last of victims, returns the slot or -1 when neither is left
+    int load(int page, std::vector<int>& victims);
+
+    // reallocates the slot pool with room for slots, keeping the resident pages where they are
+    void grow(int slots);
+
+    public:
+    PagedGeometry() = default;
+    PagedGeometry(const PagedGeometry&) = delete;
+    PagedGeometry& operator=(const PagedGeometry&) = delete;
+    ~PagedGeometry();
+
+    // creates the page file and the slot pool, budgetBytes covers the slots only
+    bool open(const std::string& path, size_t budgetBytes);
+
+    [[nodiscard]] bool isOpen() const;
+
+    // Cuts model's tree into pages and returns the resident part in nodeMin/nodeMax:
+    // the model's root at 0 and every index relative to it, boxes placed by
+    // position and scale like the scene's own nodes, links where pages were cut off
+    void split(const BaseModel& model, glm::vec3 position, glm::vec3 scale, int material,
+               std::vector<glm::vec4>& nodeMin, std::vector<glm::vec4>& nodeMax);
+
+    // uploads table entries of pages added since the last call
+    size_t sync(StagingRing& staging);
+
+    // Queues a readback of the table after frame was traced, takes in the ones
+    // that finished and loads what they missed. wait blocks on every queued
+    // readback, so the next frame sees everything missed so far. Returns the pages loaded
+    int update(int frame, StagingRing& staging, bool wait);
+
+    [[nodiscard]] const PagingStats& getStats() const;
+
+    [[nodiscard]] size_t getGpuBytes() const;
+
+    void release();
+};
+
+#endif //PAGEDGEOMETRY_H
@@ -0,0 +1,148 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "ProgramCache.h"
+#include "Shader.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+typedef void (GLAD_API_PTR *PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+uint64_t fnv1a(const std::string& data, uint64_t hash = 14695981039346656037ull) {
+    for (const unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void ProgramCache::init(const GLADloadfunc load, const std::string& directory) {
+    this->directory = directory;
+    driver = std::string(reinterpret_cast<const char*>(glGetString(GL_VENDOR))) + "|"
+           + reinterpret_cast<const char*>(glGetString(GL_RENDERER)) + "|"
+           + reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    enabled = !directory.empty() && formats > 0;
+    if (enabled) {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        enabled = !error;
+    }
+
+    const char* extension = hasExtension("GL_KHR_parallel_shader_compile") ? "glMaxShaderCompilerThreadsKHR"
+                          : hasExtension("GL_ARB_parallel_shader_compile") ? "glMaxShaderCompilerThreadsARB" : nullptr;
+    if (extension != nullptr) {
+        const auto maxThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(load(extension));
+        if (maxThreads != nullptr) {
+            maxThreads(0xFFFFFFFFu); // let the driver pick
+            parallel = true;
+        }
+    }
+
+    std::cout << "Program cache: " << (enabled ? directory : "off") << ", parallel compile: " << (parallel ? "on" : "off") << std::endl;
+}
+
+ProgramCache::Pending ProgramCache::begin(const std::string& name, const std::string& vertSource, const std::string& fragSource) const {
+    Pending pending;
+    pending.name = name;
+    pending.start = std::chrono::steady_clock::now();
+
+    if (enabled) {
+        char key[17];
+        std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(fnv1a(fragSource, fnv1a(vertSource, fnv1a(driver)))));
+        pending.path = directory + "/" + key + ".bin";
+
+        std::ifstream file(pending.path, std::ios::binary | std::ios::ate);
+        if (file.is_open()) {
+            const std::streamsize size = file.tellg();
+            file.seekg(0, std::ios::beg);
+            GLenum format = 0;
+            std::vector<char> binary(size > std::streamsize(sizeof(format)) ? size - sizeof(format) : 0);
+            file.read(reinterpret_cast<char*>(&format), sizeof(format));
+            file.read(binary.data(), std::streamsize(binary.size()));
+
+            if (file.good() && !binary.empty()) {
+                pending.program = glCreateProgram();
+                glProgramBinary(pending.program, format, binary.data(), GLsizei(binary.size()));
+                GLint linked = GL_FALSE;
+                glGetProgramiv(pending.program, GL_LINK_STATUS, &linked);
+                if (linked) {
+                    pending.cached = true;
+                    return pending;
+                }
+                // driver update or corrupt file, rebuild below
+                glDeleteProgram(pending.program);
+            }
+        }
+    }
+
+    const char* vertSrc = vertSource.c_str();
+    const char* fragSrc = fragSource.c_str();
+    pending.vert = glCreateShader(GL_VERTEX_SHADER);
+    pending.frag = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pending.vert, 1, &vertSrc, nullptr);
+    glShaderSource(pending.frag, 1, &fragSrc, nullptr);
+    glCompileShader(pending.vert);
+    glCompileShader(pending.frag);
+
+    pending.program = glCreateProgram();
+    glAttachShader(pending.program, pending.vert);
+    glAttachShader(pending.program, pending.frag);
+    if (enabled) glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(pending.program);
+    return pending;
+}
+
+GLuint ProgramCache::finish(Pending& pending) const {
+    const auto waitStart = std::chrono::steady_clock::now();
+    GLint linked = GL_FALSE;
+    glGetProgramiv(pending.program, GL_LINK_STATUS, &linked);
+    const auto end = std::chrono::steady_clock::now();
+
+    if (!pending.cached) {
+        for (const GLuint shader : {pending.vert, pending.frag}) {
+            GLint success;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success) {
+                char log[512];
+                glGetShaderInfoLog(shader, 512, nullptr, log);
+                std::cerr << "Shader compilation failed:\n" << log << std::endl;
+            }
+            glDetachShader(pending.program, shader);
+            glDeleteShader(shader);
+        }
+        pending.vert = pending.frag = 0;
+
+        if (!linked) {
+            char log[512];
+            glGetProgramInfoLog(pending.program, 512, nullptr, log);
+            std::cerr << "Program link failed:\n" << log << std::endl;
+        } else if (enabled) {
+            GLint length = 0;
+            glGetProgramiv(pending.program, GL_PROGRAM_BINARY_LENGTH, &length);
+            std::vector<char> binary(length);
+            GLenum format = 0;
+            glGetProgramBinary(pending.program, length, nullptr, &format, binary.data());
+            std::ofstream file(pending.path, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+            file.write(binary.data(), length);
+        }
+    }
+
+    const double total = std::chrono::duration<double, std::milli>(end - pending.start).count();
+    const double waited = std::chrono::duration<double, std::milli>(end - waitStart).count();
+    std::cout << "Program " << pending.name << ": " << (pending.cached ? "cache hit (warm)" : "compiled (cold)")
+              << ", finished " << total << " ms after begin, blocked " << waited << " ms" << std::endl;
+    return pending.program;
+}
@@ -0,0 +1,41 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <glad/glad.h>
+#include <chrono>
+#include <string>
+
+// Links shader programs from a binary cache (glProgramBinary) keyed by a hash
+// of the sources and the driver, falling back to compiling from source and
+// saving the result. begin() only kicks the work off; with
+// GL_KHR_parallel_shader_compile the driver compiles on its own threads, so
+// model parsing and BVH building can run before finish() is called.
+class ProgramCache {
+    std::string directory;
+    std::string driver;
+    bool enabled = false;
+    bool parallel = false;
+
+    public:
+    struct Pending {
+        std::string name;
+        std::string path;
+        GLuint program = 0;
+        GLuint vert = 0, frag = 0;
+        bool cached = false;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // directory empty disables the binary cache, parallel compile is used either way
+    void init(GLADloadfunc load, const std::string& directory);
+
+    Pending begin(const std::string& name, const std::string& vertSource, const std::string& fragSource) const;
+
+    GLuint finish(Pending& pending) const;
+};
+
+#endif //PROGRAMCACHE_H
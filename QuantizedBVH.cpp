@@ -0,0 +1,130 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "QuantizedBVH.h"
+#include "Refit.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+float fromBits(const glm::uint bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+glm::uint toBits(const float value) {
+    glm::uint bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+glm::uint packBytes(const glm::uvec3 q) {
+    return q.x | q.y << 8 | q.z << 16;
+}
+
+glm::uvec3 unpackBytes(const glm::uint packed) {
+    return glm::uvec3(packed & 0xFFu, packed >> 8 & 0xFFu, packed >> 16 & 0xFFu);
+}
+
+glm::vec3 decodeScale(const glm::uint exponents) {
+    const glm::uvec3 e = unpackBytes(exponents);
+    return glm::vec3(fromBits(e.x << 23), fromBits(e.y << 23), fromBits(e.z << 23));
+}
+
+// smallest power of two step so 255 steps cover the extent
+int stepExponent(const float extent) {
+    int exponent = -126;
+    if (extent > 0) std::frexp(extent / 255.0f, &exponent);
+    return std::clamp(exponent, -126, 127);
+}
+
+// rounds the corners outwards, then fixes up any step the float addition rounded the wrong way
+void quantizeBox(const glm::vec3 origin, const glm::vec3 scale, const glm::vec3 lo, const glm::vec3 hi, glm::uvec3& qlo, glm::uvec3& qhi) {
+    for (int axis = 0; axis < 3; ++axis) {
+        int low = int(std::clamp(std::floor((lo[axis] - origin[axis]) / scale[axis]), 0.0f, 255.0f));
+        int high = int(std::clamp(std::ceil((hi[axis] - origin[axis]) / scale[axis]), 0.0f, 255.0f));
+        while (low > 0 && origin[axis] + float(low) * scale[axis] > lo[axis]) low--;
+        while (high < 255 && origin[axis] + float(high) * scale[axis] < hi[axis]) high++;
+        qlo[axis] = glm::uint(low);
+        qhi[axis] = glm::uint(high);
+    }
+}
+
+// ref/count pair for a child of the float layout, -1 count for interior nodes.
+// Pages only exist in the float layout, a link becomes an empty leaf
+glm::ivec2 childRef(const glm::vec4& bboxMin, const glm::vec4& bboxMax) {
+    if (isPageLink(bboxMin, bboxMax)) return glm::ivec2(0, 0);
+    if (bboxMin.w <= 0) return glm::ivec2(-int(bboxMin.w), -int(bboxMax.w));
+    return glm::ivec2(0, -1);
+}
+
+int quantizeBVH(const glm::vec4* bboxMin, const glm::vec4* bboxMax, const int base, const int root, const int recordBase, std::vector<QuantizedNode>& out) {
+    // float node, and the record and child slot to point at its record; child 0 is
+    // taken first so records keep the preorder a recursive walk gives, at any depth
+    struct Work {
+        int index;
+        int parent, slot;
+    };
+    const int first = int(out.size());
+    std::vector<Work> work = {{root, -1, 0}};
+    while (!work.empty()) {
+        const Work item = work.back();
+        work.pop_back();
+        const glm::vec4& nodeMin = bboxMin[item.index - base];
+        const glm::vec4& nodeMax = bboxMax[item.index - base];
+
+        // a leaf root gets a record of its own with an empty second child
+        int children[2] = {item.index, -1};
+        if (nodeMin.w > 0) {
+            children[0] = int(nodeMin.w);
+            children[1] = int(nodeMax.w);
+        }
+
+        glm::vec3 lo[2], hi[2];
+        glm::ivec2 refs[2];
+        for (int c = 0; c < 2; ++c) {
+            if (children[c] < 0) {
+                lo[c] = hi[c] = glm::vec3(nodeMin);
+                refs[c] = glm::ivec2(0, 0);
+                continue;
+            }
+            lo[c] = glm::vec3(bboxMin[children[c] - base]);
+            hi[c] = glm::vec3(bboxMax[children[c] - base]);
+            refs[c] = childRef(bboxMin[children[c] - base], bboxMax[children[c] - base]);
+        }
+
+        const glm::vec3 origin = glm::min(lo[0], lo[1]);
+        const glm::vec3 extent = glm::max(hi[0], hi[1]) - origin;
+        const glm::uvec3 exponents(stepExponent(extent.x) + 127, stepExponent(extent.y) + 127, stepExponent(extent.z) + 127);
+
+        QuantizedNode node{};
+        node.origin = glm::uvec4(toBits(origin.x), toBits(origin.y), toBits(origin.z), packBytes(exponents));
+        const glm::vec3 scale = decodeScale(node.origin.w);
+        for (int c = 0; c < 2; ++c) {
+            glm::uvec3 qlo, qhi;
+            quantizeBox(origin, scale, lo[c], hi[c], qlo, qhi);
+            node.bounds[c*2+0] = packBytes(qlo);
+            node.bounds[c*2+1] = packBytes(qhi);
+        }
+        // interior children's refs are filled in once their records exist
+        node.children = glm::ivec4(refs[0], refs[1]);
+
+        const int record = int(out.size());
+        out.push_back(node);
+        if (item.parent >= 0) out[size_t(item.parent)].children[item.slot * 2] = recordBase + record;
+        for (int c = 1; c >= 0; --c) {
+            if (refs[c].y == -1) work.push_back({children[c], record, c});
+        }
+    }
+    return recordBase + first;
+}
+
+void decodeChild(const QuantizedNode& node, const int child, glm::vec3& boxMin, glm::vec3& boxMax) {
+    const glm::vec3 origin(fromBits(node.origin.x), fromBits(node.origin.y), fromBits(node.origin.z));
+    const glm::vec3 scale = decodeScale(node.origin.w);
+    boxMin = origin + glm::vec3(unpackBytes(node.bounds[child*2+0])) * scale;
+    boxMax = origin + glm::vec3(unpackBytes(node.bounds[child*2+1])) * scale;
+}
@@ -0,0 +1,34 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef QUANTIZEDBVH_H
+#define QUANTIZEDBVH_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// One binary BVH node holding both child boxes quantized to 8 bits per plane,
+// relative to the node's own box: 48 bytes instead of the 64 the two children
+// take in the float layout, and leaves need no record at all.
+//   origin   xyz: float bits of the box minimum, w: biased power-of-two exponent per axis (8 bits each)
+//   bounds   x/y: child A low/high corner, z/w: child B low/high corner (8 bits per axis)
+//   children x/y: child A ref/count, z/w: child B ref/count; count -1 marks an
+//            interior child whose ref is a record index, otherwise ref is the first triangle
+// Decoding is origin + q * 2^e, exact apart from the final addition, and the
+// encoder checks that result so the boxes stay conservative.
+struct QuantizedNode {
+    glm::uvec4 origin;
+    glm::uvec4 bounds;
+    glm::ivec4 children;
+};
+
+// Appends the records of the float BVH rooted at root and returns the root
+// record's index. bboxMin/bboxMax hold nodes from index base onwards and the
+// first element of out has record index recordBase.
+int quantizeBVH(const glm::vec4* bboxMin, const glm::vec4* bboxMax, int base, int root, int recordBase, std::vector<QuantizedNode>& out);
+
+// child is 0 for A and 1 for B
+void decodeChild(const QuantizedNode& node, int child, glm::vec3& boxMin, glm::vec3& boxMax);
+
+#endif //QUANTIZEDBVH_H
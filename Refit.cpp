@@ -0,0 +1,147 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "Refit.h"
+
+#include <algorithm>
+#include <thread>
+
+bool isLeaf(const glm::vec4& bboxMin) {
+    return bboxMin.w <= 0;
+}
+
+bool isPageLink(const glm::vec4& bboxMin, const glm::vec4& bboxMax) {
+    return bboxMin.w <= 0 && bboxMax.w > 0;
+}
+
+float nodeArea(const glm::vec4& min, const glm::vec4& max) {
+    const glm::vec3 size = glm::max(glm::vec3(max - min), glm::vec3(0));
+    return size.x * (size.y + size.z) + size.y * size.z;
+}
+
+std::vector<int> collectLeaves(const glm::vec4* bboxMin, const glm::vec4* bboxMax, const int root) {
+    std::vector<int> leaves;
+    std::vector<int> stack = {root};
+    while (!stack.empty()) {
+        const int node = stack.back();
+        stack.pop_back();
+        if (isPageLink(bboxMin[node], bboxMax[node])) continue;
+        if (isLeaf(bboxMin[node])) {
+            leaves.push_back(node);
+            continue;
+        }
+        stack.push_back(int(bboxMax[node].w));
+        stack.push_back(int(bboxMin[node].w));
+    }
+    return leaves;
+}
+
+std::vector<int> collectLevels(const glm::vec4* bboxMin, const glm::vec4* bboxMax, const int root, std::vector<int>& offsets) {
+    std::vector<std::vector<int>> levels;
+    std::vector<int> current = {root};
+    while (!current.empty()) {
+        std::vector<int> next;
+        for (const int node : current) {
+            if (isLeaf(bboxMin[node])) continue;
+            // a page's box never changes, its parent just reads it
+            for (const int child : {int(bboxMin[node].w), int(bboxMax[node].w)}) {
+                if (!isPageLink(bboxMin[child], bboxMax[child])) next.push_back(child);
+            }
+        }
+        levels.push_back(std::move(current));
+        current = std::move(next);
+    }
+
+    std::vector<int> nodes;
+    offsets = {0};
+    for (auto level = levels.rbegin(); level != levels.rend(); ++level) {
+        nodes.insert(nodes.end(), level->begin(), level->end());
+        offsets.push_back(int(nodes.size()));
+    }
+    return nodes;
+}
+
+void refitLeaves(glm::vec4* bboxMin, glm::vec4* bboxMax, const glm::ivec4* triangles, const glm::vec4* vertices,
+                 const int* leaves, const size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec4& min = bboxMin[leaves[i]];
+        glm::vec4& max = bboxMax[leaves[i]];
+        const int triStart = -int(min.w);
+        const int numTris = -int(max.w);
+        glm::vec3 lo(1e30f), hi(-1e30f);
+        for (int t = triStart; t < triStart + numTris; ++t) {
+            const glm::ivec4 tri = triangles[t];
+            for (const int v : {tri.x, tri.y, tri.z}) {
+                lo = glm::min(lo, glm::vec3(vertices[v]));
+                hi = glm::max(hi, glm::vec3(vertices[v]));
+            }
+        }
+        min = glm::vec4(lo, min.w);
+        max = glm::vec4(hi, max.w);
+    }
+}
+
+void refitNodes(glm::vec4* bboxMin, glm::vec4* bboxMax, const glm::ivec4* triangles, const glm::vec4* vertices,
+                const int first, const int count, const std::vector<int>& leaves) {
+    // a thread per few thousand leaves, starting threads costs more than small meshes take
+    const size_t threads = std::clamp<size_t>(leaves.size() / 2048, 1, std::max(1u, std::thread::hardware_concurrency()));
+    const size_t chunk = (leaves.size() + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t) {
+        const size_t begin = std::min(leaves.size(), t * chunk);
+        workers.emplace_back(refitLeaves, bboxMin, bboxMax, triangles, vertices, leaves.data() + begin,
+                             std::min(chunk, leaves.size() - begin));
+    }
+    refitLeaves(bboxMin, bboxMax, triangles, vertices, leaves.data(), std::min(chunk, leaves.size()));
+    for (std::thread& worker : workers) worker.join();
+
+    for (int node = first + count - 1; node >= first; --node) {
+        glm::vec4& min = bboxMin[node];
+        glm::vec4& max = bboxMax[node];
+        if (isLeaf(min)) continue;
+        const int a = int(min.w), b = int(max.w);
+        min = glm::vec4(glm::min(glm::vec3(bboxMin[a]), glm::vec3(bboxMin[b])), min.w);
+        max = glm::vec4(glm::max(glm::vec3(bboxMax[a]), glm::vec3(bboxMax[b])), max.w);
+    }
+}
+
+float treeCost(const glm::vec4* bboxMin, const glm::vec4* bboxMax, const int root) {
+    const float rootArea = nodeArea(bboxMin[root], bboxMax[root]);
+    if (rootArea <= 0) return 0;
+
+    float cost = 0;
+    std::vector<int> stack = {root};
+    while (!stack.empty()) {
+        const int node = stack.back();
+        stack.pop_back();
+        const float area = nodeArea(bboxMin[node], bboxMax[node]);
+        // what a page holds is unknown here, it counts like an interior node
+        if (isPageLink(bboxMin[node], bboxMax[node])) {
+            cost += area;
+            continue;
+        }
+        if (isLeaf(bboxMin[node])) {
+            cost += area * -bboxMax[node].w;
+            continue;
+        }
+        cost += area;
+        stack.push_back(int(bboxMin[node].w));
+        stack.push_back(int(bboxMax[node].w));
+    }
+    return cost / rootArea;
+}
+
+int treeDepth(const glm::vec4* bboxMin, const glm::vec4* bboxMax, const int root) {
+    int depth = 0;
+    std::vector<std::pair<int, int>> stack = {{root, 1}};
+    while (!stack.empty()) {
+        const auto [node, level] = stack.back();
+        stack.pop_back();
+        depth = std::max(depth, level);
+        if (isLeaf(bboxMin[node])) continue;
+        stack.emplace_back(int(bboxMin[node].w), level + 1);
+        stack.emplace_back(int(bboxMax[node].w), level + 1);
+    }
+    return depth;
+}
@@ -0,0 +1,44 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef REFIT_H
+#define REFIT_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Bottom-up refit of BVH nodes in the scene encoding (leaf: min.w = -triStart,
+// max.w = -numTris; interior: min.w / max.w = child indices) after vertices
+// moved. The topology stays as built, only the boxes follow the geometry.
+// Page links of out-of-core models (min.w = -page, max.w = 1, see
+// PagedGeometry.h) have no triangles or children on the host; they are
+// neither leaves nor interior nodes to these functions.
+
+[[nodiscard]] bool isPageLink(const glm::vec4& bboxMin, const glm::vec4& bboxMax);
+
+// leaf node indices below root, the units of work for refitNodes()
+std::vector<int> collectLeaves(const glm::vec4* bboxMin, const glm::vec4* bboxMax, int root);
+
+// node indices below root grouped by depth, deepest level first; offsets[l]..offsets[l+1]
+// is one level whose nodes only read boxes of the levels before it
+std::vector<int> collectLevels(const glm::vec4* bboxMin, const glm::vec4* bboxMax, int root, std::vector<int>& offsets);
+
+// Recomputes the leaf boxes from their triangles, spread over the hardware
+// threads, then every interior box in [first, first + count) from its
+// children. One backwards sweep sees children first, as they are stored after
+// their parent in every node order; BaseModel::buildTree restores that after
+// the tree optimizer moved nodes around.
+void refitNodes(glm::vec4* bboxMin, glm::vec4* bboxMax, const glm::ivec4* triangles, const glm::vec4* vertices,
+                int first, int count, const std::vector<int>& leaves);
+
+// SAH cost of the tree below root relative to its own root box: interior
+// nodes cost their area, leaves area times triangles. Refits only grow it,
+// so its ratio to the cost at build time measures how far the tree decayed.
+float treeCost(const glm::vec4* bboxMin, const glm::vec4* bboxMax, int root);
+
+// levels from root down to the deepest leaf, root alone counts as 1; an
+// ordered traversal never holds more than this many nodes on its stack
+int treeDepth(const glm::vec4* bboxMin, const glm::vec4* bboxMax, int root);
+
+#endif //REFIT_H
@@ -0,0 +1,58 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "ResolutionScaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+void ResolutionScaler::setTarget(const double ms, const float minScale) {
+    targetMs = ms;
+    this->minScale = std::clamp(minScale, STEP, 1.0f);
+    scale = 1;
+    samples = 0;
+}
+
+bool ResolutionScaler::isEnabled() const {
+    return targetMs > 0;
+}
+
+bool ResolutionScaler::update(const int frame, const int sampleFrame, const double sampleMs) {
+    if (!isEnabled() || sampleFrame < since || sampleFrame <= lastSample) return false;
+    lastSample = sampleFrame;
+    averageMs = samples == 0 ? sampleMs : averageMs + (sampleMs - averageMs) * SMOOTHING;
+    if (++samples < MIN_SAMPLES) return false;
+
+    const bool over = averageMs > targetMs * OVER_TARGET;
+    const bool under = averageMs < targetMs * UNDER_TARGET && scale < 1;
+    if (!over && !under) return false;
+    float wanted = scale * float(std::sqrt(targetMs * AIM / averageMs));
+    if (under) wanted = std::min(wanted, scale * MAX_GROWTH);
+    // rounded down, growing only as far as the estimate still fits
+    wanted = std::clamp(std::floor(wanted / STEP + 1e-3f) * STEP, minScale, 1.0f);
+    if (std::abs(wanted - scale) < STEP * 0.5f) return false;
+
+    scale = wanted;
+    since = frame;
+    samples = 0;
+    changes++;
+    return true;
+}
+
+float ResolutionScaler::getScale() const {
+    return scale;
+}
+
+void ResolutionScaler::traceSize(const int width, const int height, int& traceWidth, int& traceHeight) const {
+    traceWidth = std::max(1, int(std::lround(float(width) * scale)));
+    traceHeight = std::max(1, int(std::lround(float(height) * scale)));
+}
+
+int ResolutionScaler::getChanges() const {
+    return changes;
+}
+
+double ResolutionScaler::getAverageMs() const {
+    return averageMs;
+}
@@ -0,0 +1,60 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef RESOLUTIONSCALER_H
+#define RESOLUTIONSCALER_H
+
+// Dynamic resolution. Scales the traced image on both axes to hold the trace
+// pass near a GPU time target, taking its cost to follow the pixel count, so a
+// frame at scale s costs about s^2 of a full size one. Times come from the
+// FrameProfiler's timestamp queries, which arrive a few frames late: samples
+// of frames traced before the last change are dropped, and the scale only
+// moves again once a few frames at the new size were measured. Over the
+// target it drops straight to the size expected to fit, well under it it grows
+// back by at most a step at a time, and in between it holds, so accumulation,
+// which restarts at every change, gets to converge.
+class ResolutionScaler {
+    static constexpr int MIN_SAMPLES = 3;
+    static constexpr double SMOOTHING = 0.5;
+    // band the smoothed time may move in without a change, as fractions of the target
+    static constexpr double OVER_TARGET = 1.05;
+    static constexpr double UNDER_TARGET = 0.7;
+    // a new scale aims this far under the target, so it lands inside the band
+    static constexpr double AIM = 0.9;
+    static constexpr float MAX_GROWTH = 1.25f;
+    // scales are multiples of this, so noise can't nudge the size every few frames
+    static constexpr float STEP = 0.05f;
+
+    double targetMs = 0;
+    float minScale = 0.25f;
+    float scale = 1;
+    // first frame traced at the current scale and the newest sample taken in
+    int since = 0;
+    int lastSample = -1;
+    int samples = 0;
+    double averageMs = 0;
+    int changes = 0;
+
+    public:
+    // 0 ms turns scaling off
+    void setTarget(double ms, float minScale);
+
+    [[nodiscard]] bool isEnabled() const;
+
+    // Takes in the newest measured frame, sampleFrame -1 when none came back yet,
+    // before frame is traced. Returns whether the scale changed for frame
+    bool update(int frame, int sampleFrame, double sampleMs);
+
+    [[nodiscard]] float getScale() const;
+
+    // the size frames are traced at for an output of width x height
+    void traceSize(int width, int height, int& traceWidth, int& traceHeight) const;
+
+    [[nodiscard]] int getChanges() const;
+
+    // smoothed GPU time of the frames measured at the current scale
+    [[nodiscard]] double getAverageMs() const;
+};
+
+#endif //RESOLUTIONSCALER_H
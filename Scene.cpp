@@ -3,11 +3,16 @@
 #define GLAD_GL_IMPLEMENTATION
 #include <glad/glad.h>
 #include "Scene.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <tuple>
 #include <fstream>
 #include <GLFW/glfw3.h>
 #include <chrono>
 #include "BaseModel.h"
+#include "Refit.h"
+#include "Traversal.h"
 
 using Clock = std::chrono::high_resolution_clock;
 
@@ -26,6 +31,8 @@ Scene::Scene() {
 
     width = 2560;
     height = 1440;
+    traceWidth = width;
+    traceHeight = height;
 
     frameCount = 0;
 
@@ -33,7 +40,8 @@ Scene::Scene() {
 }
 
 Scene::Scene(const int width, const int height, const int samples, const int aa, const int bounceLim)
-    : samples(samples), aa(aa), bounceLim(bounceLim), frameCount(0), width(width), height(height){
+    : samples(samples), aa(aa), bounceLim(bounceLim), frameCount(0), width(width), height(height),
+      traceWidth(width), traceHeight(height) {
     camForward = glm::vec3(0, 0, -1);
     setBasisVectors(camForward, camUp, camRight);
 
@@ -43,104 +51,944 @@ Scene::Scene(const int width, const int height, const int samples, const int aa,
 void Scene::addModel(const std::string& filename, const glm::vec3 position, const glm::vec3 scale, const glm::vec3 color, const float smoothness, const float emission) {
     BaseModel model(filename);
 
-    addModel(model, position, scale, color, smoothness, emission);
+    addModel(std::move(model), position, scale, color, smoothness, emission);
 }
 
-void Scene::addModel(BaseModel& model, glm::vec3 position, glm::vec3 scale, glm::vec3 color, float smoothness, float emission) {
-    int Voffset = int(vertices.size());
-    int Toffset = int(triangles.size());
-    int BBoffset = int(boundingBoxMin.size());
+void Scene::addModel(BaseModel& model, const glm::vec3 position, const glm::vec3 scale, const glm::vec3 color, const float smoothness, const float emission) {
+    appendModel(model, position, scale, color, smoothness, emission, false);
+}
+
+void Scene::addModel(BaseModel&& model, const glm::vec3 position, const glm::vec3 scale, const glm::vec3 color, const float smoothness, const float emission) {
+    appendModel(model, position, scale, color, smoothness, emission, true);
+}
+
+template <typename T>
+void freeVector(std::vector<T>& vector) {
+    std::vector<T>().swap(vector);
+}
+
+void Scene::appendModel(BaseModel& model, glm::vec3 position, glm::vec3 scale, glm::vec3 color, float smoothness, float emission, const bool consume) {
+    ModelRange range;
+    range.vertexStart = streamedVertices + vertices.size();
+    range.triStart = streamedTriangles + triangles.size();
+    range.nodeStart = streamedNodes + boundingBoxMin.size();
+    range.color = colors.size();
+    range.quantizedStart = streamedQuantized + quantizedNodes.size();
+    range.position = position;
+    range.scale = scale;
+    range.rootMin = glm::vec3(1e30f);
+    range.rootMax = glm::vec3(-1e30f);
+
+    // the full mesh, then every LOD behind it, the root box and stack depth covering all of them
+    const auto append = [&](BaseModel& level, int& quantizedRoot) {
+        const bool empty = level.boundingBoxMin.empty();
+        if (!empty) range.depth = std::max(range.depth, treeDepth(level.boundingBoxMin.data(), level.boundingBoxMax.data(), 0));
+        const int root = appendGeometry(level, position, scale, int(colors.size()), consume, quantizedRoot);
+        if (!empty) {
+            range.rootMin = glm::min(range.rootMin, glm::vec3(boundingBoxMin[root - streamedNodes]));
+            range.rootMax = glm::max(range.rootMax, glm::vec3(boundingBoxMax[root - streamedNodes]));
+        }
+        return root;
+    };
+    const int fullTriangles = int(model.triangles.size());
+    range.paged = paging.isOpen() && fullTriangles > PagedGeometry::PAGE_TRIANGLES;
+    int quantizedRoot = -1;
+    models.push_back(append(model, quantizedRoot));
+    quantizedModels.push_back(quantizedRoot);
+    if (!model.lods.empty()) range.lods.push_back({models.back(), quantizedRoot, fullTriangles, 0});
+    for (BaseModel& lod : model.lods) {
+        const int triangleCount = int(lod.triangles.size());
+        const int root = append(lod, quantizedRoot);
+        range.lods.push_back({root, quantizedRoot, triangleCount, lod.lodError});
+    }
+    if (consume) freeVector(model.lods);
+    if (range.rootMin.x > range.rootMax.x) range.rootMin = range.rootMax = position;
+
+    range.vertexCount = streamedVertices + vertices.size() - range.vertexStart;
+    range.triCount = streamedTriangles + triangles.size() - range.triStart;
+    range.nodeCount = streamedNodes + boundingBoxMin.size() - range.nodeStart;
+    range.quantizedCount = streamedQuantized + quantizedNodes.size() - range.quantizedStart;
+    modelRanges.push_back(std::move(range));
+    instances.push_back({int(models.size()) - 1, glm::mat4(1)});
+    instancesDirty = true;
+
+    colors.emplace_back(color, smoothness);
+    this->emission.push_back(emission);
+}
+
+int Scene::appendGeometry(BaseModel& model, const glm::vec3 position, const glm::vec3 scale, const int material, const bool consume, int& quantizedRoot) {
+    quantizedRoot = -1;
+    if (paging.isOpen() && int(model.triangles.size()) > PagedGeometry::PAGE_TRIANGLES) {
+        // only the resident top is appended, links keep their page in min.w
+        const int BBoffset = int(streamedNodes + boundingBoxMin.size());
+        std::vector<glm::vec4> nodeMin, nodeMax;
+        paging.split(model, position, scale, material, nodeMin, nodeMax);
+        for (size_t i = 0; i < nodeMin.size(); ++i) {
+            if (nodeMin[i].w <= 0) continue;
+            nodeMin[i].w += float(BBoffset);
+            nodeMax[i].w += float(BBoffset);
+        }
+        boundingBoxMin.insert(boundingBoxMin.end(), nodeMin.begin(), nodeMin.end());
+        boundingBoxMax.insert(boundingBoxMax.end(), nodeMax.begin(), nodeMax.end());
+        if (consume) {
+            freeVector(model.vertices);
+            freeVector(model.triangles);
+            freeVector(model.boundingBoxMin);
+            freeVector(model.boundingBoxMax);
+        }
+        return BBoffset;
+    }
 
-    models.emplace_back(BBoffset);
+    int Voffset = int(streamedVertices + vertices.size());
+    int Toffset = int(streamedTriangles + triangles.size());
+    int BBoffset = int(streamedNodes + boundingBoxMin.size());
 
+    // vertices and triangles change type on the way in, so a consumed model
+    // only gets to free its copy early
+    vertices.reserve(vertices.size() + model.vertices.size());
     for (glm::vec3 vertex : model.vertices) {
         vertex *= scale;
         vertex += position;
         vertices.emplace_back(vertex, 0);
     }
+    if (consume) freeVector(model.vertices);
+    triangles.reserve(triangles.size() + model.triangles.size());
     for (glm::ivec3 triangle : model.triangles) {
         triangle += Voffset;
-        triangles.emplace_back(triangle, colors.size());
+        triangles.emplace_back(triangle, material);
     }
-    for (glm::vec4 bboxMin : model.boundingBoxMin) {
+    if (consume) freeVector(model.triangles);
+
+    if (triangleLayout == TriangleLayout::Precomputed) {
+        // triangles were just appended in leaf order, the data follows them one to one
+        const size_t first = triangleData.size() / 3;
+        triangleData.resize(triangles.size() * 3);
+        computeTriangleData(first, triangles.size() - first);
+    }
+
+    // the node arrays are adopted whole when the scene holds none on the host
+    const size_t nodeStart = boundingBoxMin.size();
+    if (consume && nodeStart == 0) {
+        boundingBoxMin = std::move(model.boundingBoxMin);
+        boundingBoxMax = std::move(model.boundingBoxMax);
+    } else {
+        boundingBoxMin.insert(boundingBoxMin.end(), model.boundingBoxMin.begin(), model.boundingBoxMin.end());
+        boundingBoxMax.insert(boundingBoxMax.end(), model.boundingBoxMax.begin(), model.boundingBoxMax.end());
+    }
+    if (consume) {
+        freeVector(model.boundingBoxMin);
+        freeVector(model.boundingBoxMax);
+    }
+    for (size_t i = nodeStart; i < boundingBoxMin.size(); ++i) {
+        glm::vec4& bboxMin = boundingBoxMin[i];
         bboxMin *= glm::vec4(scale,1);
-        int offset = bboxMin.w <= 0 ? Toffset : BBoffset;
+        // leaves store -triStart, so the triangle offset is subtracted
+        int offset = bboxMin.w <= 0 ? -Toffset : BBoffset;
         bboxMin += glm::vec4(position,offset);
-        boundingBoxMin.emplace_back(bboxMin);
-    }
-    for (glm::vec4 bboxMax : model.boundingBoxMax) {
+
+        glm::vec4& bboxMax = boundingBoxMax[i];
         bboxMax *= glm::vec4(scale,1);
-        int offset = bboxMax.w <= 0 ? 0 : BBoffset;
+        offset = bboxMax.w <= 0 ? 0 : BBoffset;
         bboxMax += glm::vec4(position,offset);
-        boundingBoxMax.emplace_back(bboxMax);
     }
 
+    if (traversalMode == TraversalMode::Stackless) linkParents(nodeStart, boundingBoxMin.size() - nodeStart);
+
+    if (nodeLayout == NodeLayout::Quantized) {
+        quantizedRoot = quantizeBVH(boundingBoxMin.data(), boundingBoxMax.data(), int(streamedNodes), BBoffset,
+                                    int(streamedQuantized), quantizedNodes);
+    }
+    return BBoffset;
+}
+
+int Scene::addSpheres(const SphereSet& set, const glm::vec3 color, const float smoothness, const float emission) {
+    if (set.spheres.empty() || set.boundingBoxMin.empty()) return -1;
+    const int Soffset = int(streamedSpheres + spheres.size());
+    const int BBoffset = int(streamedNodes + boundingBoxMin.size());
+    spheres.insert(spheres.end(), set.spheres.begin(), set.spheres.end());
+
+    // same offsets as appendModel, with leaves pointing into spheres
+    const size_t nodeStart = boundingBoxMin.size();
+    boundingBoxMin.insert(boundingBoxMin.end(), set.boundingBoxMin.begin(), set.boundingBoxMin.end());
+    boundingBoxMax.insert(boundingBoxMax.end(), set.boundingBoxMax.begin(), set.boundingBoxMax.end());
+    for (size_t i = nodeStart; i < boundingBoxMin.size(); ++i) {
+        const bool leaf = boundingBoxMin[i].w <= 0;
+        boundingBoxMin[i].w += leaf ? float(-Soffset) : float(BBoffset);
+        boundingBoxMax[i].w += leaf ? 0.0f : float(BBoffset);
+    }
+    if (traversalMode == TraversalMode::Stackless) linkParents(nodeStart, boundingBoxMin.size() - nodeStart);
+
+    int quantizedRoot = -1;
+    if (nodeLayout == NodeLayout::Quantized) {
+        quantizedRoot = quantizeBVH(boundingBoxMin.data(), boundingBoxMax.data(), int(streamedNodes), BBoffset, int(streamedQuantized), quantizedNodes);
+    }
+    const int depth = treeDepth(set.boundingBoxMin.data(), set.boundingBoxMax.data(), 0);
+    sphereSets.emplace_back(BBoffset, quantizedRoot, int(colors.size()), depth);
+
     colors.emplace_back(color, smoothness);
     this->emission.push_back(emission);
+    return int(sphereSets.size()) - 1;
+}
+
+int Scene::getNumSphereSets() const {
+    return int(sphereSets.size());
+}
+
+int Scene::getNumSpheres() const {
+    return int(streamedSpheres + spheres.size());
+}
+
+// first and count are host indices into triangles
+void Scene::computeTriangleData(const size_t first, const size_t count) {
+    for (size_t i = first; i < first + count; ++i) {
+        const glm::ivec4 tri = triangles[i];
+        const glm::vec3 v0 = vertices[tri.x - streamedVertices];
+        const glm::vec3 e1 = glm::vec3(vertices[tri.y - streamedVertices]) - v0;
+        const glm::vec3 e2 = glm::vec3(vertices[tri.z - streamedVertices]) - v0;
+        const glm::vec3 normal = glm::normalize(glm::cross(e1, e2));
+        triangleData[i * 3 + 0] = glm::vec4(v0, normal.x);
+        triangleData[i * 3 + 1] = glm::vec4(e1, normal.y);
+        triangleData[i * 3 + 2] = glm::vec4(e2, normal.z);
+    }
+}
+
+// re-encodes a model's quantized records in place after its float nodes changed
+void Scene::quantizeModel(const int index) {
+    const ModelRange& range = modelRanges[index];
+    std::vector<QuantizedNode> records;
+    quantizedModels[index] = quantizeBVH(boundingBoxMin.data(), boundingBoxMax.data(), 0, models[index], int(range.quantizedStart), records);
+    std::copy(records.begin(), records.end(), quantizedNodes.begin() + long(range.quantizedStart));
+}
+
+// cuts an array back to start elements, whether they are still on the host or already streamed out
+template <typename T>
+void truncate(std::vector<T>& host, size_t& streamed, const size_t start) {
+    if (start >= streamed) {
+        host.resize(start - streamed);
+        return;
+    }
+    host.clear();
+    streamed = start;
+}
+
+void Scene::removeModel(const int index) {
+    if (index < 0 || index >= int(models.size())) return;
+    const ModelRange range = modelRanges[index];
+    // sphere sets added after the model also sit past its ranges
+    const bool last = index == int(models.size()) - 1 && range.nodeStart + range.nodeCount == streamedNodes + boundingBoxMin.size();
+
+    models.erase(models.begin() + index);
+    modelRanges.erase(modelRanges.begin() + index);
+    instances.erase(std::remove_if(instances.begin(), instances.end(), [&](const Instance& instance) { return instance.model == index; }),
+                    instances.end());
+    for (Instance& instance : instances) {
+        if (instance.model > index) instance.model--;
+    }
+    instancesDirty = true;
+    quantizedModels.erase(quantizedModels.begin() + index);
+    modelBuffer.invalidate(size_t(index) * sizeof(int));
+    quantizedModelBuffer.invalidate(size_t(index) * sizeof(int));
+
+    // the geometry of a model in the middle is still indexed by nothing but
+    // can't move without patching every later model, so only the tail is trimmed
+    if (!last) return;
+    truncate(vertices, streamedVertices, range.vertexStart);
+    truncate(triangles, streamedTriangles, range.triStart);
+    if (triangleLayout == TriangleLayout::Precomputed) triangleData.resize(triangles.size() * 3);
+    size_t streamedMax = streamedNodes, streamedParents = streamedNodes;
+    truncate(boundingBoxMin, streamedNodes, range.nodeStart);
+    truncate(boundingBoxMax, streamedMax, range.nodeStart);
+    if (traversalMode == TraversalMode::Stackless) truncate(parentNodes, streamedParents, range.nodeStart);
+    truncate(quantizedNodes, streamedQuantized, range.quantizedStart);
+    colors.resize(range.color);
+    emission.resize(range.color);
+}
+
+bool Scene::updateModelVertices(const int index, const std::vector<glm::vec3>& positions) {
+    if (index < 0 || index >= int(models.size()) || !hasHostGeometry()) return false;
+    ModelRange& range = modelRanges[index];
+    if (positions.size() != range.vertexCount || !range.lods.empty() || range.paged) return false;
+
+    const auto t = Clock::now();
+    const int root = models[index];
+    if (range.leaves.empty()) {
+        range.leaves = collectLeaves(boundingBoxMin.data(), boundingBoxMax.data(), root);
+        range.buildCost = treeCost(boundingBoxMin.data(), boundingBoxMax.data(), root);
+    }
+    for (size_t i = 0; i < positions.size(); ++i) {
+        vertices[range.vertexStart + i] = glm::vec4(positions[i] * range.scale + range.position, 0);
+    }
+    range.dirty = true;
+
+    if (refitMode == RefitMode::Compute) {
+        if (range.levels.empty()) {
+            const std::vector<int> nodes = collectLevels(boundingBoxMin.data(), boundingBoxMax.data(), root, range.levels);
+            range.refitStart = refitOrder.size();
+            refitOrder.insert(refitOrder.end(), nodes.begin(), nodes.end());
+        }
+        // the refit root stays on the GPU, but the top level needs it to cull the moved
+        // geometry; the vertices' bounds are the same box, or a looser one around unused vertices
+        glm::vec3 rootMin(1e30f), rootMax(-1e30f);
+        for (size_t i = 0; i < positions.size(); ++i) {
+            rootMin = glm::min(rootMin, glm::vec3(vertices[range.vertexStart + i]));
+            rootMax = glm::max(rootMax, glm::vec3(vertices[range.vertexStart + i]));
+        }
+        range.rootMin = rootMin;
+        range.rootMax = rootMax;
+        instancesDirty = true;
+        refitStats.refits++;
+        refitStats.refitMs += std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+        return true;
+    }
+
+    refitNodes(boundingBoxMin.data(), boundingBoxMax.data(), triangles.data(), vertices.data(), int(range.nodeStart), int(range.nodeCount), range.leaves);
+    refitStats.refits++;
+    refitStats.refitMs += std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+
+    // refit boxes only grow apart as the mesh deforms, rebuild once traversal would pay too much for it
+    if (treeCost(boundingBoxMin.data(), boundingBoxMax.data(), root) > range.buildCost * rebuildRatio) {
+        const auto rebuildStart = Clock::now();
+        if (rebuildModel(index)) {
+            refitStats.rebuilds++;
+        } else {
+            // keep the refit tree as the new reference rather than retrying every frame
+            range.buildCost = treeCost(boundingBoxMin.data(), boundingBoxMax.data(), root);
+            refitStats.rebuildsSkipped++;
+        }
+        refitStats.rebuildMs += std::chrono::duration<double, std::milli>(Clock::now() - rebuildStart).count();
+    }
+
+    if (triangleLayout == TriangleLayout::Precomputed) computeTriangleData(range.triStart, range.triCount);
+    if (nodeLayout == NodeLayout::Quantized) quantizeModel(index);
+    range.rootMin = glm::vec3(boundingBoxMin[root]);
+    range.rootMax = glm::vec3(boundingBoxMax[root]);
+    instancesDirty = true;
+    return true;
+}
+
+// Builds a fresh BVH over the model's current vertices and writes it over the
+// old one. The arrays of later models can't move, so it has to fit the old ranges.
+bool Scene::rebuildModel(const int index) {
+    ModelRange& range = modelRanges[index];
+
+    BaseModel model;
+    model.vertices.reserve(range.vertexCount);
+    for (size_t i = 0; i < range.vertexCount; ++i) model.vertices.emplace_back(vertices[range.vertexStart + i]);
+
+    // SBVH leaves reference some triangles more than once, each is built once here
+    const auto first = triangles.begin() + long(range.triStart);
+    std::vector<glm::ivec4> unique(first, first + long(range.triCount));
+    const auto less = [](const glm::ivec4& a, const glm::ivec4& b) {
+        return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+    };
+    std::sort(unique.begin(), unique.end(), less);
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    model.triangles.reserve(unique.size());
+    for (const glm::ivec4& tri : unique) model.triangles.emplace_back(glm::ivec3(tri) - int(range.vertexStart));
+
+    // no deeper than the deepest tree already loaded, which the shader's stack was sized for
+    model.createBVH(std::max(getTreeDepth(), 32), 5, 0, int(model.triangles.size()));
+    model.reorderNodes(NodeOrder::DepthFirst);
+    if (model.boundingBoxMin.size() > range.nodeCount) return false;
+    range.depth = treeDepth(model.boundingBoxMin.data(), model.boundingBoxMax.data(), 0);
+
+    const int material = unique.empty() ? 0 : unique[0].w;
+    for (size_t i = 0; i < model.triangles.size(); ++i) {
+        triangles[range.triStart + i] = glm::ivec4(model.triangles[i] + int(range.vertexStart), material);
+    }
+
+    // same offsets as appendModel, the padding past the new tree is empty leaves nothing points to
+    const int Toffset = int(range.triStart), BBoffset = int(range.nodeStart);
+    for (size_t i = 0; i < range.nodeCount; ++i) {
+        glm::vec4 bboxMin(0), bboxMax(0);
+        if (i < model.boundingBoxMin.size()) {
+            bboxMin = model.boundingBoxMin[i];
+            bboxMax = model.boundingBoxMax[i];
+            bboxMin.w += bboxMin.w <= 0 ? float(-Toffset) : float(BBoffset);
+            bboxMax.w += bboxMax.w <= 0 ? 0.0f : float(BBoffset);
+        }
+        boundingBoxMin[range.nodeStart + i] = bboxMin;
+        boundingBoxMax[range.nodeStart + i] = bboxMax;
+    }
+
+    if (traversalMode == TraversalMode::Stackless) linkParents(range.nodeStart, range.nodeCount);
+
+    range.leaves = collectLeaves(boundingBoxMin.data(), boundingBoxMax.data(), models[index]);
+    range.buildCost = treeCost(boundingBoxMin.data(), boundingBoxMax.data(), models[index]);
+    range.dirtyTriangles = true;
+    return true;
+}
+
+std::vector<glm::vec3> Scene::getModelVertices(const int index) const {
+    std::vector<glm::vec3> positions;
+    if (index < 0 || index >= int(models.size()) || !hasHostGeometry()) return positions;
+    const ModelRange& range = modelRanges[index];
+    if (!range.lods.empty() || range.paged) return positions;
+    positions.reserve(range.vertexCount);
+    for (size_t i = 0; i < range.vertexCount; ++i) {
+        positions.push_back((glm::vec3(vertices[range.vertexStart + i]) - range.position) / range.scale);
+    }
+    return positions;
+}
+
+void Scene::setRefitMode(const RefitMode mode, const GLuint program) {
+    refitMode = mode;
+    refitProgram = program;
+    if (mode == RefitMode::Compute && (program == 0 || nodeLayout != NodeLayout::Float || triangleLayout != TriangleLayout::Indexed)) {
+        std::cout << "GPU refit needs float nodes and indexed triangles, refitting on the CPU" << std::endl;
+        refitMode = RefitMode::Host;
+    }
+}
+
+void Scene::setRebuildRatio(const float ratio) {
+    rebuildRatio = ratio;
+}
+
+const RefitStats& Scene::getRefitStats() const {
+    return refitStats;
+}
+
+int Scene::addInstance(const int model, const glm::mat4& transform) {
+    if (model < 0 || model >= int(models.size())) return -1;
+    instances.push_back({model, transform});
+    instancesDirty = true;
+    return int(instances.size()) - 1;
+}
+
+void Scene::setInstanceTransform(const int instance, const glm::mat4& transform) {
+    if (instance < 0 || instance >= int(instances.size())) return;
+    instances[instance].transform = transform;
+    instancesDirty = true;
+}
+
+glm::mat4 Scene::getInstanceTransform(const int instance) const {
+    if (instance < 0 || instance >= int(instances.size())) return glm::mat4(1);
+    return instances[instance].transform;
+}
+
+int Scene::getNumInstances() const {
+    return int(instances.size());
+}
+
+void Scene::setInstancing(const bool enabled) {
+    instancing = enabled;
+    instancesDirty = true;
+}
+
+bool Scene::getInstancing() const {
+    return instancing;
+}
+
+int Scene::getTreeDepth() const {
+    int depth = 0;
+    for (const ModelRange& range : modelRanges) depth = std::max(depth, range.depth);
+    for (const glm::ivec4& set : sphereSets) depth = std::max(depth, set.w);
+    return depth;
+}
+
+int Scene::chooseLod(const ModelRange& range, const glm::mat4& transform) const {
+    // world box of the root box as in buildInstances(), the distance is to its nearest point
+    const glm::vec3 center = transform * glm::vec4((range.rootMin + range.rootMax) * 0.5f, 1);
+    const glm::vec3 extent = (range.rootMax - range.rootMin) * 0.5f;
+    glm::vec3 radius(0);
+    float transformScale = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        radius += glm::abs(glm::vec3(transform[axis])) * extent[axis];
+        transformScale = std::max(transformScale, glm::length(glm::vec3(transform[axis])));
+    }
+    const float distance = glm::length(glm::max(glm::abs(cameraPos - center) - radius, glm::vec3(0)));
+    if (distance <= 0) return 0;
+
+    // the shader's vertical field of view is 90 degrees, so a unit at distance d covers traceHeight / 2d traced pixels
+    const float pixelsPerUnit = float(traceHeight) * 0.5f / distance;
+    const float worldScale = std::max(range.scale.x, std::max(range.scale.y, range.scale.z)) * transformScale;
+    int lod = 0;
+    for (int i = 1; i < int(range.lods.size()); ++i) {
+        if (range.lods[i].error * worldScale * pixelsPerUnit > lodPixelError) break;
+        lod = i;
+    }
+    return lod;
+}
+
+bool Scene::updateLods() {
+    bool changed = false;
+    if (instancing) {
+        for (Instance& instance : instances) {
+            const ModelRange& range = modelRanges[instance.model];
+            if (range.lods.empty()) continue;
+            const int lod = chooseLod(range, instance.transform);
+            if (lod == instance.lod) continue;
+            instance.lod = lod;
+            changed = true;
+        }
+        if (changed) instancesDirty = true;
+        return changed;
+    }
+    // without instancing models draw as added, only their root entries change
+    for (size_t i = 0; i < modelRanges.size(); ++i) {
+        ModelRange& range = modelRanges[i];
+        if (range.lods.empty()) continue;
+        const int lod = chooseLod(range, glm::mat4(1));
+        if (lod == range.lod) continue;
+        range.lod = lod;
+        models[i] = range.lods[lod].root;
+        quantizedModels[i] = range.lods[lod].quantizedRoot;
+        modelBuffer.invalidate(i * sizeof(int));
+        quantizedModelBuffer.invalidate(i * sizeof(int));
+        changed = true;
+    }
+    return changed;
+}
+
+void Scene::setLodPixelError(const float pixels) {
+    lodPixelError = pixels;
+}
+
+void Scene::getLodTriangles(size_t& selected, size_t& full) const {
+    selected = full = 0;
+    if (instancing) {
+        for (const Instance& instance : instances) {
+            const ModelRange& range = modelRanges[instance.model];
+            if (range.lods.empty()) continue;
+            selected += range.lods[instance.lod].triangles;
+            full += range.lods[0].triangles;
+        }
+        return;
+    }
+    for (const ModelRange& range : modelRanges) {
+        if (range.lods.empty()) continue;
+        selected += range.lods[range.lod].triangles;
+        full += range.lods[0].triangles;
+    }
+}
+
+const InstanceStats& Scene::getInstanceStats() const {
+    return instanceStats;
 }
 
-void Scene::set_ssbo() const {
-    GLuint ssboVertices;
-    glGenBuffers(1, &ssboVertices);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboVertices);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, int(vertices.size() * sizeof(glm::vec4)), vertices.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssboVertices);
-
-    GLuint ssboTriangles;
-    glGenBuffers(1, &ssboTriangles);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboTriangles);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, int(triangles.size() * sizeof(glm::ivec4)), triangles.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssboTriangles);
-
-    GLuint ssboColors;
-    glGenBuffers(1, &ssboColors);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboColors);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, int(colors.size() * sizeof(glm::vec4)), colors.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssboColors);
-
-    GLuint ssboEmission;
-    glGenBuffers(1, &ssboEmission);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboEmission);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, int(emission.size() * sizeof(float)), emission.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, ssboEmission);
-
-    GLuint ssboBoundingBoxMin;
-    glGenBuffers(1, &ssboBoundingBoxMin);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboBoundingBoxMin);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, int(boundingBoxMin.size() * sizeof(glm::vec4)), boundingBoxMin.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, ssboBoundingBoxMin);
-
-    GLuint ssboBoundingBoxMax;
-    glGenBuffers(1, &ssboBoundingBoxMax);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboBoundingBoxMax);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, int(boundingBoxMax.size() * sizeof(glm::vec4)), boundingBoxMax.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, ssboBoundingBoxMax);
-
-    GLuint ssboModels;
-    glGenBuffers(1, &ssboModels);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboModels);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, int(models.size() * sizeof(int)), models.data(), GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, ssboModels);
+void Scene::buildInstances() {
+    // world boxes of the transformed root boxes, from the center and the absolute matrix applied to the extent
+    std::vector<glm::vec3> boxMin(instances.size()), boxMax(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const ModelRange& range = modelRanges[instances[i].model];
+        const glm::mat4& transform = instances[i].transform;
+        const glm::vec3 center = transform * glm::vec4((range.rootMin + range.rootMax) * 0.5f, 1);
+        const glm::vec3 extent = (range.rootMax - range.rootMin) * 0.5f;
+        glm::vec3 radius(0);
+        for (int axis = 0; axis < 3; ++axis) radius += glm::abs(glm::vec3(transform[axis])) * extent[axis];
+        boxMin[i] = center - radius;
+        boxMax[i] = center + radius;
+    }
+
+    std::vector<int> order;
+    buildTopLevel(boxMin, boxMax, order, topLevelNodes);
+
+    instanceRecords.resize(instances.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        const Instance& instance = instances[order[i]];
+        const glm::mat4 inverse = glm::inverse(instance.transform);
+        InstanceRecord& record = instanceRecords[i];
+        for (int row = 0; row < 3; ++row) record.worldToModel[row] = glm::vec4(inverse[0][row], inverse[1][row], inverse[2][row], inverse[3][row]);
+        const ModelRange& range = modelRanges[instance.model];
+        if (range.lods.empty()) {
+            record.info = glm::ivec4(models[instance.model], quantizedModels[instance.model], instance.model, 0);
+        } else {
+            const LodLevel& level = range.lods[instance.lod];
+            record.info = glm::ivec4(level.root, level.quantizedRoot, instance.model, 0);
+        }
+    }
+}
+
+// one dispatch per tree level, deepest first, each waiting for the writes of the one before
+void Scene::refitOnGpu(const ModelRange& range) const {
+    const GLint first = glGetUniformLocation(refitProgram, "first");
+    const GLint count = glGetUniformLocation(refitProgram, "count");
+    for (size_t level = 0; level + 1 < range.levels.size(); ++level) {
+        const int nodes = range.levels[level + 1] - range.levels[level];
+        glUniform1i(first, int(range.refitStart) + range.levels[level]);
+        glUniform1i(count, nodes);
+        glDispatchCompute(GLuint(nodes + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+}
+
+// sends the ranges updateModelVertices() touched, only where they were uploaded before
+size_t Scene::uploadDirtyRanges(StagingRing& staging) {
+    size_t uploaded = 0;
+    for (ModelRange& range : modelRanges) {
+        if (!range.dirty) continue;
+        uploaded += vertexBuffer.patch(&vertices[range.vertexStart], range.vertexStart * sizeof(glm::vec4), range.vertexCount * sizeof(glm::vec4), staging);
+        if (range.dirtyTriangles) {
+            uploaded += triangleBuffer.patch(&triangles[range.triStart], range.triStart * sizeof(glm::ivec4), range.triCount * sizeof(glm::ivec4), staging);
+            // a rebuild also relinks the parents
+            if (traversalMode == TraversalMode::Stackless) {
+                uploaded += parentBuffer.patch(&parentNodes[range.nodeStart], range.nodeStart * sizeof(int), range.nodeCount * sizeof(int), staging);
+            }
+        }
+        if (triangleLayout == TriangleLayout::Precomputed) {
+            uploaded += triangleDataBuffer.patch(&triangleData[range.triStart * 3], range.triStart * 3 * sizeof(glm::vec4), range.triCount * 3 * sizeof(glm::vec4), staging);
+        }
+        if (refitMode == RefitMode::Host) {
+            if (nodeLayout == NodeLayout::Quantized) {
+                uploaded += quantizedNodeBuffer.patch(&quantizedNodes[range.quantizedStart], range.quantizedStart * sizeof(QuantizedNode), range.quantizedCount * sizeof(QuantizedNode), staging);
+            } else {
+                uploaded += boundingBoxMinBuffer.patch(&boundingBoxMin[range.nodeStart], range.nodeStart * sizeof(glm::vec4), range.nodeCount * sizeof(glm::vec4), staging);
+                uploaded += boundingBoxMaxBuffer.patch(&boundingBoxMax[range.nodeStart], range.nodeStart * sizeof(glm::vec4), range.nodeCount * sizeof(glm::vec4), staging);
+            }
+        }
+    }
+    return uploaded;
+}
+
+size_t Scene::set_ssbo(StagingRing& staging) {
+    size_t uploaded = uploadDirtyRanges(staging);
+    // precomputed triangles don't need the vertices, triangles[] is still read for the material on a hit
+    const bool precomputed = triangleLayout == TriangleLayout::Precomputed;
+    const size_t vertexBytes = precomputed ? 0 : (streamedVertices + vertices.size()) * sizeof(glm::vec4);
+    uploaded += vertexBuffer.sync(vertices.data(), vertexBytes, staging, streamedVertices * sizeof(glm::vec4));
+    uploaded += triangleBuffer.sync(triangles.data(), (streamedTriangles + triangles.size()) * sizeof(glm::ivec4), staging, streamedTriangles * sizeof(glm::ivec4));
+    const size_t dataBytes = precomputed ? (streamedTriangles + triangles.size()) * 3 * sizeof(glm::vec4) : 0;
+    uploaded += triangleDataBuffer.sync(triangleData.data(), dataBytes, staging, streamedTriangles * 3 * sizeof(glm::vec4));
+    uploaded += colorBuffer.sync(colors.data(), colors.size() * sizeof(glm::vec4), staging);
+    uploaded += emissionBuffer.sync(emission.data(), emission.size() * sizeof(float), staging);
+    // the quantized layout replaces the float nodes on the GPU
+    const bool quantized = nodeLayout == NodeLayout::Quantized;
+    const size_t nodeBytes = quantized ? 0 : (streamedNodes + boundingBoxMin.size()) * sizeof(glm::vec4);
+    uploaded += boundingBoxMinBuffer.sync(boundingBoxMin.data(), nodeBytes, staging, streamedNodes * sizeof(glm::vec4));
+    uploaded += boundingBoxMaxBuffer.sync(boundingBoxMax.data(), nodeBytes, staging, streamedNodes * sizeof(glm::vec4));
+    const size_t parentBytes = traversalMode == TraversalMode::Stackless ? (streamedNodes + parentNodes.size()) * sizeof(int) : 0;
+    uploaded += parentBuffer.sync(parentNodes.data(), parentBytes, staging, streamedNodes * sizeof(int));
+    uploaded += modelBuffer.sync(models.data(), models.size() * sizeof(int), staging);
+    const size_t quantizedBytes = (streamedQuantized + quantizedNodes.size()) * sizeof(QuantizedNode);
+    uploaded += quantizedNodeBuffer.sync(quantizedNodes.data(), quantizedBytes, staging, streamedQuantized * sizeof(QuantizedNode));
+    uploaded += quantizedModelBuffer.sync(quantizedModels.data(), quantized ? quantizedModels.size() * sizeof(int) : 0, staging);
+    uploaded += sphereBuffer.sync(spheres.data(), (streamedSpheres + spheres.size()) * sizeof(glm::vec4), staging, streamedSpheres * sizeof(glm::vec4));
+    uploaded += sphereSetBuffer.sync(sphereSets.data(), sphereSets.size() * sizeof(glm::ivec4), staging);
+    uploaded += paging.sync(staging);
+
+    if (refitMode == RefitMode::Compute) {
+        uploaded += refitNodeBuffer.sync(refitOrder.data(), refitOrder.size() * sizeof(int), staging);
+        GLint current = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+        glUseProgram(refitProgram);
+        for (const ModelRange& range : modelRanges) {
+            if (range.dirty) refitOnGpu(range);
+        }
+        glUseProgram(GLuint(current));
+    }
+    for (ModelRange& range : modelRanges) range.dirty = range.dirtyTriangles = false;
+
+    if (instancing && instancesDirty) {
+        const auto t = Clock::now();
+        buildInstances();
+        // both are tiny and rewritten whole, sync() orphans the old storage
+        topLevelBuffer.invalidate(0);
+        instanceBuffer.invalidate(0);
+        size_t bytes = topLevelBuffer.sync(topLevelNodes.data(), topLevelNodes.size() * sizeof(glm::vec4), staging);
+        bytes += instanceBuffer.sync(instanceRecords.data(), instanceRecords.size() * sizeof(InstanceRecord), staging);
+        instancesDirty = false;
+        instanceStats.builds++;
+        instanceStats.buildMs += std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+        instanceStats.uploadedBytes += bytes;
+        uploaded += bytes;
+    }
+
+    if (geometryMode == GeometryMode::Streaming) {
+        streamedVertices += vertices.size();
+        streamedTriangles += triangles.size();
+        streamedNodes += boundingBoxMin.size();
+        streamedQuantized += quantizedNodes.size();
+        streamedSpheres += spheres.size();
+        freeVector(spheres);
+        freeVector(quantizedNodes);
+        freeVector(vertices);
+        freeVector(triangles);
+        freeVector(triangleData);
+        freeVector(boundingBoxMin);
+        freeVector(boundingBoxMax);
+        freeVector(parentNodes);
+    }
+    return uploaded;
+}
+
+void Scene::releaseBuffers() {
+    vertexBuffer.release();
+    triangleBuffer.release();
+    triangleDataBuffer.release();
+    colorBuffer.release();
+    emissionBuffer.release();
+    boundingBoxMinBuffer.release();
+    boundingBoxMaxBuffer.release();
+    modelBuffer.release();
+    quantizedNodeBuffer.release();
+    quantizedModelBuffer.release();
+    refitNodeBuffer.release();
+    topLevelBuffer.release();
+    instanceBuffer.release();
+    parentBuffer.release();
+    sphereBuffer.release();
+    sphereSetBuffer.release();
+    paging.release();
+}
+
+void Scene::setGeometryMode(const GeometryMode mode) {
+    geometryMode = mode;
+}
+
+GeometryMode Scene::getGeometryMode() const {
+    return geometryMode;
+}
+
+bool Scene::hasHostGeometry() const {
+    return streamedNodes == 0;
+}
+
+size_t Scene::getHostBytes() const {
+    return vertices.capacity() * sizeof(glm::vec4) + triangles.capacity() * sizeof(glm::ivec4)
+         + triangleData.capacity() * sizeof(glm::vec4)
+         + (boundingBoxMin.capacity() + boundingBoxMax.capacity()) * sizeof(glm::vec4)
+         + colors.capacity() * sizeof(glm::vec4) + emission.capacity() * sizeof(float)
+         + models.capacity() * sizeof(int) + modelRanges.capacity() * sizeof(ModelRange)
+         + quantizedNodes.capacity() * sizeof(QuantizedNode) + quantizedModels.capacity() * sizeof(int)
+         + refitOrder.capacity() * sizeof(int) + instances.capacity() * sizeof(Instance)
+         + topLevelNodes.capacity() * sizeof(glm::vec4) + instanceRecords.capacity() * sizeof(InstanceRecord)
+         + spheres.capacity() * sizeof(glm::vec4) + sphereSets.capacity() * sizeof(glm::ivec4);
+}
+
+size_t Scene::getGpuBytes() const {
+    return vertexBuffer.getCapacity() + triangleBuffer.getCapacity() + triangleDataBuffer.getCapacity() + colorBuffer.getCapacity()
+         + emissionBuffer.getCapacity() + boundingBoxMinBuffer.getCapacity() + boundingBoxMaxBuffer.getCapacity()
+         + modelBuffer.getCapacity() + quantizedNodeBuffer.getCapacity() + quantizedModelBuffer.getCapacity()
+         + refitNodeBuffer.getCapacity() + topLevelBuffer.getCapacity() + instanceBuffer.getCapacity()
+         + parentBuffer.getCapacity() + sphereBuffer.getCapacity() + sphereSetBuffer.getCapacity()
+         + paging.getGpuBytes();
+}
+
+void Scene::setNodeLayout(const NodeLayout layout) {
+    nodeLayout = layout;
+}
+
+NodeLayout Scene::getNodeLayout() const {
+    return nodeLayout;
+}
+
+size_t Scene::getNodeBytes() const {
+    if (nodeLayout == NodeLayout::Quantized) return (streamedQuantized + quantizedNodes.size()) * sizeof(QuantizedNode);
+    const size_t parentBytes = traversalMode == TraversalMode::Stackless ? sizeof(int) : 0;
+    return (streamedNodes + boundingBoxMin.size()) * (2 * sizeof(glm::vec4) + parentBytes);
+}
+
+void Scene::setTraversalMode(const TraversalMode mode) {
+    traversalMode = mode;
+    if (mode == TraversalMode::Stackless && nodeLayout != NodeLayout::Float) {
+        std::cout << "Stackless traversal needs float nodes, using the stack" << std::endl;
+        traversalMode = TraversalMode::Stack;
+    }
+}
+
+TraversalMode Scene::getTraversalMode() const {
+    return traversalMode;
+}
+
+void Scene::linkParents(const size_t first, const size_t count) {
+    parentNodes.resize(boundingBoxMin.size(), -1);
+    std::fill(parentNodes.begin() + long(first), parentNodes.begin() + long(first + count), -1);
+    for (size_t i = first; i < first + count; ++i) {
+        if (boundingBoxMin[i].w <= 0) continue;
+        // child indices are global, the host arrays start at streamedNodes
+        const int node = int(streamedNodes + i);
+        parentNodes[size_t(boundingBoxMin[i].w) - streamedNodes] = node;
+        parentNodes[size_t(boundingBoxMax[i].w) - streamedNodes] = node;
+    }
+}
+
+bool Scene::setPaging(const std::string& path, const size_t budgetBytes) {
+    if (nodeLayout != NodeLayout::Float || traversalMode != TraversalMode::Stack) {
+        std::cout << "Paging needs float nodes and the stack traversal, keeping every model resident" << std::endl;
+        return false;
+    }
+    return paging.open(path, budgetBytes);
+}
+
+bool Scene::isPaged() const {
+    return paging.isOpen();
+}
+
+int Scene::updatePages(StagingRing& staging, const bool wait) {
+    if (!paging.isOpen()) return 0;
+    const int loaded = paging.update(pageFrame++, staging, wait);
+    // what was accumulated so far is missing the pages that just arrived
+    if (loaded > 0) frameCount = 0;
+    return loaded;
+}
+
+const PagingStats& Scene::getPagingStats() const {
+    return paging.getStats();
+}
+
+void Scene::setTriangleLayout(const TriangleLayout layout) {
+    triangleLayout = layout;
+}
+
+TriangleLayout Scene::getTriangleLayout() const {
+    return triangleLayout;
+}
+
+size_t Scene::getTriangleBytes() const {
+    const size_t tris = streamedTriangles + triangles.size();
+    if (triangleLayout == TriangleLayout::Precomputed) return tris * (sizeof(glm::ivec4) + 3 * sizeof(glm::vec4));
+    return tris * sizeof(glm::ivec4) + (streamedVertices + vertices.size()) * sizeof(glm::vec4);
+}
+
+void Scene::benchmarkTraversal(const int rays) const {
+    if (!hasHostGeometry() || models.empty()) return;
+    if (isPaged()) {
+        std::cout << "--traversal-bench needs resident models, paged triangles are only in the page file" << std::endl;
+        return;
+    }
+
+    // the other layout is built here so both can be compared whatever the scene uses
+    std::vector<QuantizedNode> nodes;
+    std::vector<int> roots;
+    for (const int model : models) roots.push_back(quantizeBVH(boundingBoxMin.data(), boundingBoxMax.data(), 0, model, 0, nodes));
+    std::vector<int> parents(boundingBoxMin.size(), -1);
+    for (size_t i = 0; i < boundingBoxMin.size(); ++i) {
+        if (boundingBoxMin[i].w <= 0) continue;
+        parents[size_t(boundingBoxMin[i].w)] = parents[size_t(boundingBoxMax[i].w)] = int(i);
+    }
+
+    // primary rays in scanline order over the view, like neighbouring shader invocations
+    const int columns = std::max(1, int(std::sqrt(float(rays) * 16.0f / 9.0f)));
+    const int rows = std::max(1, rays / columns);
+    std::vector<glm::vec3> dirs;
+    dirs.reserve(size_t(columns) * rows);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            const float sx = (2 * (float(x) + 0.5f) / float(columns) - 1) * 16.0f / 9.0f;
+            const float sy = 2 * (float(y) + 0.5f) / float(rows) - 1;
+            dirs.push_back(glm::normalize(camForward + camRight * sx + camUp * sy));
+        }
+    }
+
+    std::vector<RayHit> floatHits(dirs.size()), quantizedHits(dirs.size());
+    auto t = Clock::now();
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        for (const int model : models) traverseBinary(boundingBoxMin.data(), boundingBoxMax.data(), triangles.data(), vertices.data(), model, cameraPos, dirs[i], floatHits[i]);
+    }
+    const double floatMs = std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+    t = Clock::now();
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        for (const int root : roots) traverseQuantized(nodes.data(), triangles.data(), vertices.data(), root, cameraPos, dirs[i], quantizedHits[i]);
+    }
+    const double quantizedMs = std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+    std::vector<RayHit> stacklessHits(dirs.size());
+    t = Clock::now();
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        for (const int model : models) {
+            traverseStackless(boundingBoxMin.data(), boundingBoxMax.data(), parents.data(), triangles.data(), vertices.data(), model, cameraPos, dirs[i], stacklessHits[i]);
+        }
+    }
+    const double stacklessMs = std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+
+    // second, untimed pass through a 32 KB L1 model
+    CacheModel floatCache, quantizedCache, stacklessCache;
+    for (const glm::vec3& dir : dirs) {
+        RayHit hit;
+        hit.cache = &floatCache;
+        for (const int model : models) traverseBinary(boundingBoxMin.data(), boundingBoxMax.data(), triangles.data(), vertices.data(), model, cameraPos, dir, hit);
+        hit = RayHit();
+        hit.cache = &quantizedCache;
+        for (const int root : roots) traverseQuantized(nodes.data(), triangles.data(), vertices.data(), root, cameraPos, dir, hit);
+        hit = RayHit();
+        hit.cache = &stacklessCache;
+        for (const int model : models) {
+            traverseStackless(boundingBoxMin.data(), boundingBoxMax.data(), parents.data(), triangles.data(), vertices.data(), model, cameraPos, dir, hit);
+        }
+    }
+
+    int mismatches = 0;
+    long floatNodeTests = 0, quantizedNodeTests = 0, floatTriTests = 0, quantizedTriTests = 0;
+    long overflows = 0, stacklessNodeTests = 0;
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        // equal distances on different triangles are ties (shared edges), not errors
+        const RayHit& a = floatHits[i];
+        const RayHit& b = quantizedHits[i];
+        const RayHit& c = stacklessHits[i];
+        if ((a.tri < 0) != (b.tri < 0) || std::abs(a.t - b.t) > 1e-4f * a.t) mismatches++;
+        if ((a.tri < 0) != (c.tri < 0) || std::abs(a.t - c.t) > 1e-4f * a.t) mismatches++;
+        stacklessNodeTests += c.nodeTests;
+        floatNodeTests += floatHits[i].nodeTests;
+        quantizedNodeTests += quantizedHits[i].nodeTests;
+        floatTriTests += floatHits[i].triTests;
+        quantizedTriTests += quantizedHits[i].triTests;
+        overflows += floatHits[i].overflows + quantizedHits[i].overflows;
+    }
+
+    const double n = double(dirs.size());
+    std::cout << std::endl;
+    std::cout << "CPU Traversal (" << dirs.size() << " rays)" << std::endl;
+    std::cout << "  -  float:     " << n / floatMs / 1000.0 << " MRays/s, " << double(boundingBoxMin.size()) * 32 / (1 << 20)
+              << " MB, node tests " << double(floatNodeTests) / n << ", tri tests " << double(floatTriTests) / n
+              << ", L1 misses " << double(floatCache.misses) / n << std::endl;
+    std::cout << "  -  quantized: " << n / quantizedMs / 1000.0 << " MRays/s, " << double(nodes.size() * sizeof(QuantizedNode)) / (1 << 20)
+              << " MB, node tests " << double(quantizedNodeTests) / n << ", tri tests " << double(quantizedTriTests) / n
+              << ", L1 misses " << double(quantizedCache.misses) / n << std::endl;
+    std::cout << "  -  stackless: " << n / stacklessMs / 1000.0 << " MRays/s, " << double(parents.size() * sizeof(int)) / (1 << 20)
+              << " MB of parent links, node tests " << double(stacklessNodeTests) / n << ", L1 misses "
+              << double(stacklessCache.misses) / n << std::endl;
+    std::cout << "  -  mismatched hits: " << mismatches << ", stack overflows: " << overflows << " (tree depth "
+              << getTreeDepth() << ")" << std::endl;
 }
 
 int Scene::getNumBVHNodes() const {
-    return int(boundingBoxMin.size());
+    return int(streamedNodes + boundingBoxMin.size());
 }
 
 int Scene::getNumTris() const {
-    return int(triangles.size());
+    return int(streamedTriangles + triangles.size());
+}
+
+int Scene::getNumModels() const {
+    return int(models.size());
+}
+
+int Scene::getSamples() const {
+    return samples;
+}
+
+int Scene::getAA() const {
+    return aa;
+}
+
+int Scene::getBounceLim() const {
+    return bounceLim;
+}
+
+void Scene::resetAccumulation() {
+    frameCount = 0;
+}
+
+void Scene::setResolution(const int width, const int height) {
+    if (width == traceWidth && height == traceHeight) return;
+    traceWidth = width;
+    traceHeight = height;
+    // the accumulated frames were traced at the old size
+    frameCount = 0;
 }
 
 void Scene::setUniforms(const GLuint shaderProgram) const {
     const auto end = Clock::now();
-    const glm::uint duration = static_cast<glm::uint>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    glm::uint duration = static_cast<glm::uint>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    if (fixedSeed) duration = seed + glm::uint(frameNumber) * 1000003u;
 
     glUniform1i(glGetUniformLocation(shaderProgram, "numModels"), int(models.size()));
+    glUniform1i(glGetUniformLocation(shaderProgram, "numSphereSets"), int(sphereSets.size()));
+    glUniform1i(glGetUniformLocation(shaderProgram, "pageFrame"), pageFrame);
     glUniform3f(glGetUniformLocation(shaderProgram, "cameraPos"), cameraPos.x, cameraPos.y, cameraPos.z);
     glUniform3f(glGetUniformLocation(shaderProgram, "camForward"), camForward.x, camForward.y, camForward.z);
     glUniform3f(glGetUniformLocation(shaderProgram, "camUp"), camUp.x, camUp.y, camUp.z);
     glUniform3f(glGetUniformLocation(shaderProgram, "camRight"), camRight.x, camRight.y, camRight.z);
-    glUniform2f(glGetUniformLocation(shaderProgram, "resolution"), static_cast<float>(width), static_cast<float>(height));
+    glUniform2f(glGetUniformLocation(shaderProgram, "resolution"), static_cast<float>(traceWidth), static_cast<float>(traceHeight));
     glUniform1i(glGetUniformLocation(shaderProgram, "frameCount"), frameCount);
     glUniform1i(glGetUniformLocation(shaderProgram, "numNodes"), getNumBVHNodes());
     glUniform1i(glGetUniformLocation(shaderProgram, "samples"), samples);
@@ -152,6 +1000,26 @@ void Scene::setUniforms(const GLuint shaderProgram) const {
     glUniform3f(glGetUniformLocation(shaderProgram, "sunColor"), sunStrength*sunColor.x, sunStrength*sunColor.y, sunStrength*sunColor.z);
 }
 
+void Scene::setCamera(const glm::vec3 position, const glm::vec3 forward) {
+    cameraPos = position;
+    camForward = glm::normalize(forward);
+    setBasisVectors(camForward, camUp, camRight);
+    frameCount = 0;
+}
+
+glm::vec3 Scene::getCameraPos() const {
+    return cameraPos;
+}
+
+glm::vec3 Scene::getCameraForward() const {
+    return camForward;
+}
+
+void Scene::setSeed(const glm::uint seed) {
+    fixedSeed = true;
+    this->seed = seed;
+}
+
 bool Scene::updateCamera(GLFWwindow& window, float speed, float sensitivity, float dt) {
     double xpos, ypos;
     bool moved = false;
@@ -211,10 +1079,32 @@ void Scene::updateFrame(const GLuint shaderProgram, GLFWwindow& window, float dt
     setUniforms(shaderProgram);
 
     frameCount++;
+    frameNumber++;
 
     if (moved) frameCount = 0;
 }
 
+void Scene::updateFrame(const GLuint shaderProgram) {
+    setUniforms(shaderProgram);
+
+    frameCount++;
+    frameNumber++;
+}
+
+void Scene::updateFrame(const GLuint shaderProgram, const glm::vec3 position, const glm::vec3 forward) {
+    if (position != cameraPos || glm::normalize(forward) != camForward) {
+        cameraPos = position;
+        camForward = glm::normalize(forward);
+        setBasisVectors(camForward, camUp, camRight);
+        frameCount = 0;
+    }
+
+    setUniforms(shaderProgram);
+
+    frameCount++;
+    frameNumber++;
+}
+
 int Scene::numTriBelow(int index) {
     const glm::vec4 bboxMin = boundingBoxMin[index];
     const glm::vec4 bboxMax = boundingBoxMax[index];
@@ -227,6 +1117,8 @@ int Scene::numTriBelow(int index) {
 void Scene::get_BVH_stats(int index, int& leafNodes, int& depth, int& minDepth, int& maxDepth, int& triPerLeaf, int& minTriPerLeaf, int& maxTriPerLeaf, int current_depth) {
     glm::vec4 bboxMin = boundingBoxMin[index];
     glm::vec4 bboxMax = boundingBoxMax[index];
+    // what is below a page link is in the page file, the stats cover the resident tree
+    if (isPageLink(bboxMin, bboxMax)) return;
     if (bboxMin.w > 0.0f) {
         get_BVH_stats(int(bboxMin.w), leafNodes, depth, minDepth, maxDepth, triPerLeaf, minTriPerLeaf, maxTriPerLeaf, current_depth+1);
         get_BVH_stats(int(bboxMax.w), leafNodes, depth, minDepth, maxDepth, triPerLeaf, minTriPerLeaf, maxTriPerLeaf, current_depth+1);
@@ -4,10 +4,59 @@
 
 #ifndef SCENE_H
 #define SCENE_H
+#include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <string>
 #include <GLFW/glfw3.h>
 #include "BaseModel.h"
+#include "GpuBuffer.h"
+#include "PagedGeometry.h"
+#include "QuantizedBVH.h"
+#include "SphereSet.h"
+#include "TopLevel.h"
+
+// What happens to model geometry on its way to the GPU:
+//  Retained  - addModel copies it, the scene keeps a host copy for CPU queries
+//  Moved     - models passed as rvalues are consumed instead of copied, the scene keeps it
+//  Streaming - like Moved, and the host copy is freed as soon as it is uploaded
+enum class GeometryMode { Retained, Moved, Streaming };
+
+// How BVH nodes are laid out on the GPU. Float is the two-array vec4 layout,
+// Quantized stores each node's child boxes in 8 bits per plane (QuantizedBVH.h).
+enum class NodeLayout { Float, Quantized };
+
+// How triangles are fetched by the hit test. Indexed reads triangles[] then
+// three vertices; Precomputed also stores v0, both edges and the geometric
+// normal per triangle in leaf order, so leaves read sequential memory.
+enum class TriangleLayout { Indexed, Precomputed };
+
+// How the shader walks float nodes. Stack keeps a per-invocation stack of
+// nodes still to visit; Stackless follows per-node parent links instead,
+// which costs an extra int per node and some recomputation on the way up
+// but no local memory. Stackless needs the float node layout.
+enum class TraversalMode { Stack, Stackless };
+
+// Where animated models get their nodes refit after updateModelVertices().
+// Host refits on the CPU threads and keeps the host nodes current, which the
+// rebuild check needs. Compute refits level by level in shaders/refit.comp
+// from the uploaded vertices, so only vertices are sent; the host nodes go
+// stale and the tree is never rebuilt. It needs float nodes and indexed triangles.
+enum class RefitMode { Host, Compute };
+
+struct RefitStats {
+    int refits = 0;
+    int rebuilds = 0;
+    // rebuilds skipped because the new tree needed more nodes than the model's range holds
+    int rebuildsSkipped = 0;
+    double refitMs = 0;
+    double rebuildMs = 0;
+};
+
+struct InstanceStats {
+    int builds = 0;
+    double buildMs = 0;
+    size_t uploadedBytes = 0;
+};
 
 class Scene {
     std::vector<glm::vec4> vertices;
@@ -20,6 +69,118 @@ class Scene {
 
     std::vector<int> models;
 
+    struct LodLevel {
+        int root, quantizedRoot;
+        int triangles;
+        // simplification error in model units, 0 for the full mesh
+        float error;
+    };
+
+    // where each model's data lives, so removing it can give the space back
+    // and animating it only touches its own ranges
+    struct ModelRange {
+        size_t vertexStart, triStart, nodeStart, color, quantizedStart;
+        size_t vertexCount, triCount, nodeCount, quantizedCount;
+        glm::vec3 position, scale;
+        // root box in the model's own space, what the top-level BVH places
+        glm::vec3 rootMin, rootMax;
+        // levels in the model's tree, what the traversal stack has to hold, the deepest of its LODs
+        int depth = 0;
+        // full mesh first, then the simplified levels appended behind it in the same ranges;
+        // empty for models without LODs. lod is the level models[] points at
+        std::vector<LodLevel> lods;
+        int lod = 0;
+        // the full mesh went to the page file, only the top of its tree is in the node arrays
+        bool paged = false;
+        // filled on the first update: SAH cost as built, leaves to refit, GPU refit levels in refitOrder
+        float buildCost = 0;
+        std::vector<int> leaves;
+        std::vector<int> levels;
+        size_t refitStart = 0;
+        // ranges edited since the last set_ssbo()
+        bool dirty = false;
+        bool dirtyTriangles = false;
+    };
+    std::vector<ModelRange> modelRanges;
+
+    GeometryMode geometryMode = GeometryMode::Retained;
+    // elements already uploaded and dropped from the host arrays when streaming
+    size_t streamedVertices = 0;
+    size_t streamedTriangles = 0;
+    size_t streamedNodes = 0;
+
+    NodeLayout nodeLayout = NodeLayout::Float;
+    TraversalMode traversalMode = TraversalMode::Stack;
+    // parent node per float node for stackless traversal, -1 for roots, shares streamedNodes
+    std::vector<int> parentNodes;
+
+    // parent links for the host nodes [first, first + count)
+    void linkParents(size_t first, size_t count);
+    TriangleLayout triangleLayout = TriangleLayout::Indexed;
+    // three vec4 per triangle: (v0, n.x), (e1, n.y), (e2, n.z), shares streamedTriangles
+    std::vector<glm::vec4> triangleData;
+    // built alongside the float nodes when the layout is Quantized, one root record per model
+    std::vector<QuantizedNode> quantizedNodes;
+    std::vector<int> quantizedModels;
+    size_t streamedQuantized = 0;
+
+    // analytic spheres of every set in leaf order (SphereSet.h), shares nothing with the triangles
+    std::vector<glm::vec4> spheres;
+    size_t streamedSpheres = 0;
+    // per set: float root, quantized root (-1 without), material and tree depth.
+    // Set nodes sit in the node arrays with the models' but their leaves index spheres
+    std::vector<glm::ivec4> sphereSets;
+
+    void appendModel(BaseModel& model, glm::vec3 position, glm::vec3 scale, glm::vec3 color, float smoothness, float emission, bool consume);
+
+    // models of more than PAGE_TRIANGLES triangles are paged once setPaging() succeeded
+    PagedGeometry paging;
+    // counts updatePages() calls, what the shader stamps reached pages with
+    int pageFrame = 0;
+
+    // appends one level's geometry and tree, returns its float root and sets its quantized one
+    int appendGeometry(BaseModel& model, glm::vec3 position, glm::vec3 scale, int material, bool consume, int& quantizedRoot);
+
+    // pixels a level's error may cover on screen before a finer level is drawn
+    float lodPixelError = 1;
+
+    // coarsest level of the model whose error stays under lodPixelError where transform places it
+    [[nodiscard]] int chooseLod(const ModelRange& range, const glm::mat4& transform) const;
+
+    void computeTriangleData(size_t first, size_t count);
+
+    void quantizeModel(int index);
+
+    RefitMode refitMode = RefitMode::Host;
+    GLuint refitProgram = 0;
+    float rebuildRatio = 1.5f;
+    // node indices of every animated model grouped by depth, see ModelRange::levels
+    std::vector<int> refitOrder;
+    RefitStats refitStats;
+
+    bool rebuildModel(int index);
+
+    void refitOnGpu(const ModelRange& range) const;
+
+    size_t uploadDirtyRanges(StagingRing& staging);
+
+    // scene graph: every placed copy of a model, see addInstance()
+    struct Instance {
+        int model;
+        glm::mat4 transform;
+        // level of detail picked by updateLods()
+        int lod = 0;
+    };
+    std::vector<Instance> instances;
+    bool instancing = false;
+    bool instancesDirty = true;
+    // rebuilt together whenever an instance moved, in top-level leaf order
+    std::vector<glm::vec4> topLevelNodes;
+    std::vector<InstanceRecord> instanceRecords;
+    InstanceStats instanceStats;
+
+    void buildInstances();
+
     int samples;
     int aa;
     int bounceLim;
@@ -32,13 +193,38 @@ class Scene {
     bool lock;
 
     int frameCount;
+    int frameNumber = 0;
     int width, height;
+    // what frames are traced at, below width x height with dynamic resolution
+    int traceWidth, traceHeight;
+
+    // replaces the wall-clock time uniform so runs are reproducible
+    bool fixedSeed = false;
+    glm::uint seed = 0;
 
     glm::vec3 skyColor = glm::vec3(0.5,0.7,0.9);
     glm::vec3 sunDir = glm::vec3(-0.1, 1, 0.1);
     float sunStrength = 1;
     glm::vec3 sunColor = glm::vec3(1, .7, .3);
 
+    // one buffer per SSBO binding point, kept across set_ssbo() calls
+    GpuBuffer vertexBuffer{0};
+    GpuBuffer triangleBuffer{1};
+    GpuBuffer colorBuffer{2};
+    GpuBuffer triangleDataBuffer{3};
+    GpuBuffer emissionBuffer{4};
+    GpuBuffer boundingBoxMinBuffer{5};
+    GpuBuffer boundingBoxMaxBuffer{6};
+    GpuBuffer modelBuffer{7};
+    GpuBuffer quantizedNodeBuffer{8};
+    GpuBuffer quantizedModelBuffer{9};
+    GpuBuffer refitNodeBuffer{10};
+    GpuBuffer topLevelBuffer{11};
+    GpuBuffer instanceBuffer{12};
+    GpuBuffer parentBuffer{13};
+    GpuBuffer sphereBuffer{14};
+    GpuBuffer sphereSetBuffer{15};
+
     public:
     Scene();
     Scene(int width, int height, int samples, int aa, int bounceLim);
@@ -49,18 +235,167 @@ class Scene {
 
     void addModel(BaseModel& model, glm::vec3 position, glm::vec3 scale, glm::vec3 color, float smoothness, float emission);
 
-    void set_ssbo() const;
+    // takes the model's arrays over instead of copying them, the model is left empty
+    void addModel(BaseModel&& model, glm::vec3 position, glm::vec3 scale, glm::vec3 color, float smoothness, float emission);
+
+    // Adds a built sphere set in world space with one material, returns its index.
+    // Sets are traced by the SPHERES variant next to the models but are not
+    // instanced, animated or removable
+    int addSpheres(const SphereSet& set, glm::vec3 color, float smoothness, float emission);
+
+    [[nodiscard]] int getNumSphereSets() const;
+
+    [[nodiscard]] int getNumSpheres() const;
+
+    // Levels of detail. Models built with BuildOptions::lodLevels keep their
+    // simplified levels next to the full mesh, each with its own tree. This
+    // picks per model, or per instance with instancing on, the coarsest level
+    // whose error projects to at most the pixel error at the camera, and
+    // returns whether any selection changed; set_ssbo() then only sends the
+    // changed roots or the rebuilt top level. Models with LODs can't be animated.
+    bool updateLods();
+
+    void setLodPixelError(float pixels);
+
+    // triangles in the levels currently selected and in the full meshes, over models with LODs
+    void getLodTriangles(size_t& selected, size_t& full) const;
+
+    // Out-of-core geometry. Models added afterwards with more than
+    // PagedGeometry::PAGE_TRIANGLES triangles keep only the top of their tree
+    // resident and stream the rest from a page file at path through a slot
+    // pool of budgetBytes (the PAGED shader variant). Needs float nodes and
+    // the stack traversal; paged models can't be animated.
+    bool setPaging(const std::string& path, size_t budgetBytes);
+
+    [[nodiscard]] bool isPaged() const;
+
+    // Call after every traced frame: reads back which pages rays missed and
+    // loads them, restarting accumulation when geometry arrived. wait blocks
+    // until every frame traced so far was read back. Returns the pages loaded
+    int updatePages(StagingRing& staging, bool wait = false);
+
+    [[nodiscard]] const PagingStats& getPagingStats() const;
+
+    // removes a model by its position in the model list. Its geometry is only
+    // freed when it sits at the end of the arrays, otherwise it stays unreferenced
+    void removeModel(int index);
+
+    // Replaces a model's vertices for animation (skinning, keyframes, ...), positions are
+    // in the model's own space in the order getModelVertices() returns them. The nodes
+    // are refit to the new positions and the whole model is rebuilt in place once the
+    // refit tree costs rebuildRatio times what it did as built. Only the model's own
+    // ranges are uploaded by the next set_ssbo(). Needs host geometry.
+    bool updateModelVertices(int index, const std::vector<glm::vec3>& positions);
+
+    [[nodiscard]] std::vector<glm::vec3> getModelVertices(int index) const;
+
+    // program is the linked shaders/refit.comp, only used by RefitMode::Compute
+    void setRefitMode(RefitMode mode, GLuint program = 0);
+
+    void setRebuildRatio(float ratio);
+
+    [[nodiscard]] const RefitStats& getRefitStats() const;
+
+    // Scene graph. Models are placed through instances: addModel() adds one with the
+    // identity transform, addInstance() further copies sharing the model's BVH. A
+    // transform takes the model as it was added into world space. Instances only
+    // apply with instancing on, which traces through a top-level BVH over them
+    // (the INSTANCES shader variant); set_ssbo() rebuilds it after any instance
+    // moved and uploads just that and the transforms. Without it models draw as added.
+    int addInstance(int model, const glm::mat4& transform);
+
+    void setInstanceTransform(int instance, const glm::mat4& transform);
+
+    [[nodiscard]] glm::mat4 getInstanceTransform(int instance) const;
+
+    [[nodiscard]] int getNumInstances() const;
+
+    void setInstancing(bool enabled);
+
+    [[nodiscard]] bool getInstancing() const;
+
+    // deepest tree over all models, in levels
+    [[nodiscard]] int getTreeDepth() const;
+
+    [[nodiscard]] const InstanceStats& getInstanceStats() const;
+
+    // uploads whatever changed since the last call, returns the bytes sent
+    size_t set_ssbo(StagingRing& staging);
+
+    void releaseBuffers();
+
+    void setGeometryMode(GeometryMode mode);
+
+    [[nodiscard]] GeometryMode getGeometryMode() const;
+
+    // false once streaming dropped uploaded geometry, the BVH stats and dumps need it
+    [[nodiscard]] bool hasHostGeometry() const;
+
+    // only takes effect for models added afterwards
+    void setNodeLayout(NodeLayout layout);
+
+    [[nodiscard]] NodeLayout getNodeLayout() const;
+
+    [[nodiscard]] size_t getNodeBytes() const;
+
+    // only takes effect for models added afterwards, falls back to Stack with quantized nodes
+    void setTraversalMode(TraversalMode mode);
+
+    [[nodiscard]] TraversalMode getTraversalMode() const;
+
+    // only takes effect for models added afterwards
+    void setTriangleLayout(TriangleLayout layout);
+
+    [[nodiscard]] TriangleLayout getTriangleLayout() const;
+
+    // GPU bytes of everything the hit test reads for triangles
+    [[nodiscard]] size_t getTriangleBytes() const;
+
+    // traces rays from the camera on the CPU through both node layouts,
+    // checks they agree and prints rays/s for each (needs host geometry)
+    void benchmarkTraversal(int rays) const;
+
+    [[nodiscard]] size_t getHostBytes() const;
+
+    [[nodiscard]] size_t getGpuBytes() const;
 
     [[nodiscard]] int getNumBVHNodes() const;
 
     [[nodiscard]] int getNumTris() const;
 
+    [[nodiscard]] int getNumModels() const;
+
+    [[nodiscard]] int getSamples() const;
+
+    [[nodiscard]] int getAA() const;
+
+    [[nodiscard]] int getBounceLim() const;
+
+    void resetAccumulation();
+
+    // size of the frames traced from now on, restarting accumulation when it changed
+    void setResolution(int width, int height);
+
     void setUniforms(GLuint shaderProgram) const;
 
+    void setCamera(glm::vec3 position, glm::vec3 forward);
+
+    [[nodiscard]] glm::vec3 getCameraPos() const;
+
+    [[nodiscard]] glm::vec3 getCameraForward() const;
+
+    void setSeed(glm::uint seed);
+
     bool updateCamera(GLFWwindow& window, float speed, float sensitivity, float dt);
 
     void updateFrame(GLuint shaderProgram, GLFWwindow& window, float dt);
 
+    // advances accumulation without reading any input (headless runs)
+    void updateFrame(GLuint shaderProgram);
+
+    // advances accumulation from a recorded pose, restarting it when the pose changed
+    void updateFrame(GLuint shaderProgram, glm::vec3 position, glm::vec3 forward);
+
     int numTriBelow(int index);
 
     void get_BVH_stats(int index, int& leafNodes, int& depth, int& minDepth, int& maxDepth, int& triPerLeaf, int& minTriPerLeaf, int& maxTriPerLeaf, int current_depth);
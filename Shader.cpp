@@ -0,0 +1,80 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "Shader.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::string loadShaderSource(const char* path) {
+    std::ifstream file(path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+GLuint compileShader(GLenum type, const std::string& source) {
+    GLuint shader = glCreateShader(type);
+    const char* src = source.c_str();
+    glShaderSource(shader, 1, &src, nullptr);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char log[512];
+        glGetShaderInfoLog(shader, 512, nullptr, log);
+        std::cerr << "Shader compilation failed:\n" << log << std::endl;
+    }
+    return shader;
+}
+GLuint createShaderProgram(const char* vertPath, const char* fragPath) {
+    return createShaderProgramFromSource(loadShaderSource(vertPath), loadShaderSource(fragPath));
+}
+GLuint createShaderProgramFromSource(const std::string& vertSource, const std::string& fragSource) {
+    GLuint vert = compileShader(GL_VERTEX_SHADER, vertSource);
+    GLuint frag = compileShader(GL_FRAGMENT_SHADER, fragSource);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vert);
+    glAttachShader(program, frag);
+    glLinkProgram(program);
+
+    glDeleteShader(vert);
+    glDeleteShader(frag);
+    return program;
+}
+
+GLuint createComputeProgram(const char* path) {
+    GLuint shader = compileShader(GL_COMPUTE_SHADER, loadShaderSource(path));
+    GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char log[512];
+        glGetProgramInfoLog(program, 512, nullptr, log);
+        std::cerr << "Program linking failed:\n" << log << std::endl;
+    }
+    glDeleteShader(shader);
+    return program;
+}
+std::string injectDefines(const std::string& source, const std::string& defines) {
+    if (defines.empty()) return source;
+    const size_t version = source.find("#version");
+    const size_t lineEnd = version == std::string::npos ? std::string::npos : source.find('\n', version);
+    if (lineEnd == std::string::npos) return defines + source;
+    return source.substr(0, lineEnd + 1) + defines + "#line 2\n" + source.substr(lineEnd + 1);
+}
+bool hasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const auto extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension != nullptr && std::strcmp(extension, name) == 0) return true;
+    }
+    return false;
+}
@@ -0,0 +1,28 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef SHADER_H
+#define SHADER_H
+
+#include <glad/glad.h>
+#include <string>
+
+std::string loadShaderSource(const char* path);
+
+GLuint compileShader(GLenum type, const std::string& source);
+
+GLuint createShaderProgram(const char* vertPath, const char* fragPath);
+
+GLuint createShaderProgramFromSource(const std::string& vertSource, const std::string& fragSource);
+
+GLuint createComputeProgram(const char* path);
+
+// Inserts preprocessor lines right after the #version line, keeping the
+// original line numbers in compile errors.
+std::string injectDefines(const std::string& source, const std::string& defines);
+
+// true when the current context advertises the extension
+bool hasExtension(const char* name);
+
+#endif //SHADER_H
@@ -0,0 +1,83 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "ShaderVariants.h"
+#include "Shader.h"
+
+
+std::string ShaderKey::defines() const {
+    std::string out;
+    if (specialized) {
+        out += "#define BOUNCE_LIM " + std::to_string(bounceLim) + "\n";
+        out += "#define SAMPLES " + std::to_string(samples) + "\n";
+        out += "#define AA " + std::to_string(aa) + "\n";
+        out += "#define NUM_MODELS " + std::to_string(numModels) + "\n";
+    }
+    if (debugMode != 0) {
+        out += "#define DEBUG_MODE " + std::to_string(debugMode) + "\n";
+    }
+    if (quantizedBVH) out += "#define QUANTIZED_BVH 1\n";
+    if (triangleData) out += "#define TRIANGLE_DATA 1\n";
+    if (instances) out += "#define INSTANCES 1\n";
+    if (stackless) out += "#define STACKLESS 1\n";
+    if (spheres) out += "#define SPHERES 1\n";
+    if (paged) out += "#define PAGED 1\n";
+    if (stackSize > 0) out += "#define MAX_STACK_SIZE " + std::to_string(stackSize) + "\n";
+    return out;
+}
+
+std::string ShaderKey::name() const {
+    std::string out = "generic";
+    if (specialized) {
+        out = "specialized bounces=" + std::to_string(bounceLim) + " samples=" + std::to_string(samples)
+            + " aa=" + std::to_string(aa) + " models=" + std::to_string(numModels);
+    }
+    if (debugMode != 0) out += " debug=" + std::to_string(debugMode);
+    if (quantizedBVH) out += " quantized";
+    if (triangleData) out += " precomputed-tris";
+    if (instances) out += " instanced";
+    if (stackless) out += " stackless";
+    if (spheres) out += " spheres";
+    if (paged) out += " paged";
+    if (stackSize > 0) out += " stack=" + std::to_string(stackSize);
+    return out;
+}
+
+bool ShaderVariants::load(const char* vertPath, const char* fragPath, const ProgramCache& cache) {
+    this->cache = &cache;
+    vertSource = loadShaderSource(vertPath);
+    fragSource = loadShaderSource(fragPath);
+    return !vertSource.empty() && !fragSource.empty();
+}
+
+void ShaderVariants::prefetch(const ShaderKey& key) {
+    const std::string defines = key.defines();
+    if (programs.count(defines) > 0 || pending.count(defines) > 0) return;
+    pending.emplace(defines, cache->begin(key.name(), vertSource, injectDefines(fragSource, defines)));
+}
+
+GLuint ShaderVariants::get(const ShaderKey& key) {
+    const std::string defines = key.defines();
+    const auto found = programs.find(defines);
+    if (found != programs.end()) return found->second;
+
+    prefetch(key);
+    const auto started = pending.find(defines);
+    const GLuint program = cache->finish(started->second);
+    pending.erase(started);
+
+    programs.emplace(defines, program);
+    return program;
+}
+
+void ShaderVariants::release() {
+    for (auto& [defines, started] : pending) {
+        glDeleteProgram(cache->finish(started));
+    }
+    pending.clear();
+    for (const auto& [defines, program] : programs) {
+        glDeleteProgram(program);
+    }
+    programs.clear();
+}
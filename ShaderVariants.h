@@ -0,0 +1,61 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include <glad/glad.h>
+#include <map>
+#include <string>
+#include "ProgramCache.h"
+
+// Compile-time values baked into a fullscreen.frag permutation. The generic
+// variant keeps everything as uniforms; a specialized one turns bounceLim,
+// samples, aa and numModels into constants. quantizedBVH and triangleData
+// pick the node and triangle layouts, instances traces through the scene's
+// top-level BVH, stackless walks float nodes by their parent links, spheres
+// also traces the scene's sphere sets, paged reaches models through the page
+// slots of PagedGeometry, and a nonzero stackSize replaces the default
+// 33-entry traversal stack; they apply to either.
+struct ShaderKey {
+    bool specialized = false;
+    int bounceLim = 0;
+    int samples = 0;
+    int aa = 0;
+    int numModels = 0;
+    int debugMode = 0;
+    bool quantizedBVH = false;
+    bool triangleData = false;
+    bool instances = false;
+    bool stackless = false;
+    bool spheres = false;
+    bool paged = false;
+    int stackSize = 0;
+
+    [[nodiscard]] std::string defines() const;
+
+    [[nodiscard]] std::string name() const;
+};
+
+// Programs built from one vertex/fragment pair, compiled on first use and
+// cached by their #define block (and on disk through the ProgramCache).
+class ShaderVariants {
+    const ProgramCache* cache = nullptr;
+    std::string vertSource;
+    std::string fragSource;
+    std::map<std::string, GLuint> programs;
+    std::map<std::string, ProgramCache::Pending> pending;
+
+    public:
+    bool load(const char* vertPath, const char* fragPath, const ProgramCache& cache);
+
+    // starts compiling in the background, get() picks the result up
+    void prefetch(const ShaderKey& key);
+
+    GLuint get(const ShaderKey& key);
+
+    void release();
+};
+
+#endif //SHADERVARIANTS_H
@@ -0,0 +1,276 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "SpatialSplitBuilder.h"
+
+#include <algorithm>
+#include <iostream>
+
+constexpr int NUM_BINS = 16;
+// spatial splits are only tried when the object split children overlap by more than this share of the root area
+constexpr float OVERLAP_THRESHOLD = 1e-5f;
+
+float halfArea(const glm::vec3 min, const glm::vec3 max) {
+    const glm::vec3 size = glm::max(max - min, glm::vec3(0));
+    return size.x * (size.y + size.z) + size.y * size.z;
+}
+
+struct Bin {
+    glm::vec3 min = glm::vec3(1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+    int count = 0;
+    int entries = 0;
+    int exits = 0;
+
+    void grow(const glm::vec3 lo, const glm::vec3 hi) {
+        min = glm::min(min, lo);
+        max = glm::max(max, hi);
+    }
+};
+
+SpatialSplitBuilder::SpatialSplitBuilder(BaseModel& model) : model(model) {}
+
+SpatialSplitBuilder::Split SpatialSplitBuilder::objectSplit(const std::vector<Reference>& refs, glm::vec3& overlapMin, glm::vec3& overlapMax) const {
+    glm::vec3 centroidMin(1e30f), centroidMax(-1e30f);
+    for (const Reference& ref : refs) {
+        const glm::vec3 centroid = (ref.min + ref.max) * 0.5f;
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+
+    Split best;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float extent = centroidMax[axis] - centroidMin[axis];
+        if (extent <= 0) continue;
+
+        Bin bins[NUM_BINS];
+        for (const Reference& ref : refs) {
+            const float centroid = (ref.min[axis] + ref.max[axis]) * 0.5f;
+            const int b = std::min(NUM_BINS - 1, int((centroid - centroidMin[axis]) / extent * NUM_BINS));
+            bins[b].grow(ref.min, ref.max);
+            bins[b].count++;
+        }
+
+        // right-to-left sweep first so the left sweep can evaluate every plane
+        float rightCost[NUM_BINS];
+        Bin right;
+        for (int b = NUM_BINS - 1; b > 0; --b) {
+            right.grow(bins[b].min, bins[b].max);
+            right.count += bins[b].count;
+            rightCost[b] = halfArea(right.min, right.max) * float(right.count);
+        }
+        Bin left;
+        for (int b = 0; b < NUM_BINS - 1; ++b) {
+            left.grow(bins[b].min, bins[b].max);
+            left.count += bins[b].count;
+            if (left.count == 0 || left.count == int(refs.size())) continue;
+            const float cost = halfArea(left.min, left.max) * float(left.count) + rightCost[b + 1];
+            if (cost < best.cost) {
+                best.cost = cost;
+                best.axis = axis;
+                best.pos = centroidMin[axis] + extent * float(b + 1) / NUM_BINS;
+
+                Bin rest;
+                for (int r = b + 1; r < NUM_BINS; ++r) rest.grow(bins[r].min, bins[r].max);
+                overlapMin = glm::max(left.min, rest.min);
+                overlapMax = glm::min(left.max, rest.max);
+            }
+        }
+    }
+    return best;
+}
+
+bool SpatialSplitBuilder::clip(const Reference& ref, const int axis, const float lo, const float hi, Reference& out) const {
+    const glm::ivec3 tri = source[ref.tri];
+    const glm::vec3 v[3] = {model.vertices[tri.x], model.vertices[tri.y], model.vertices[tri.z]};
+
+    glm::vec3 min(1e30f), max(-1e30f);
+    for (int i = 0; i < 3; ++i) {
+        const glm::vec3 a = v[i];
+        const glm::vec3 b = v[(i + 1) % 3];
+        if (a[axis] >= lo && a[axis] <= hi) {
+            min = glm::min(min, a);
+            max = glm::max(max, a);
+        }
+        for (const float plane : {lo, hi}) {
+            if ((a[axis] - plane) * (b[axis] - plane) >= 0) continue;
+            glm::vec3 p = a + (b - a) * ((plane - a[axis]) / (b[axis] - a[axis]));
+            p[axis] = plane;
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+    }
+
+    out.tri = ref.tri;
+    out.min = glm::max(min, ref.min);
+    out.max = glm::min(max, ref.max);
+    out.min[axis] = std::max(out.min[axis], lo);
+    out.max[axis] = std::min(out.max[axis], hi);
+    return out.min.x <= out.max.x && out.min.y <= out.max.y && out.min.z <= out.max.z;
+}
+
+SpatialSplitBuilder::Split SpatialSplitBuilder::spatialSplit(const std::vector<Reference>& refs, const glm::vec3 min, const glm::vec3 max) const {
+    Split best;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float extent = max[axis] - min[axis];
+        if (extent <= 0) continue;
+        const float width = extent / NUM_BINS;
+
+        Bin bins[NUM_BINS];
+        for (const Reference& ref : refs) {
+            const int first = std::clamp(int((ref.min[axis] - min[axis]) / width), 0, NUM_BINS - 1);
+            const int last = std::clamp(int((ref.max[axis] - min[axis]) / width), first, NUM_BINS - 1);
+            bins[first].entries++;
+            bins[last].exits++;
+            if (first == last) {
+                bins[first].grow(ref.min, ref.max);
+                continue;
+            }
+            for (int b = first; b <= last; ++b) {
+                Reference part{};
+                if (clip(ref, axis, min[axis] + width * float(b), min[axis] + width * float(b + 1), part)) bins[b].grow(part.min, part.max);
+            }
+        }
+
+        float rightCost[NUM_BINS];
+        int rightCount[NUM_BINS];
+        Bin right;
+        for (int b = NUM_BINS - 1; b > 0; --b) {
+            right.grow(bins[b].min, bins[b].max);
+            right.count += bins[b].exits;
+            rightCount[b] = right.count;
+            rightCost[b] = halfArea(right.min, right.max) * float(right.count);
+        }
+        Bin left;
+        for (int b = 0; b < NUM_BINS - 1; ++b) {
+            left.grow(bins[b].min, bins[b].max);
+            left.count += bins[b].entries;
+            if (left.count == 0 || rightCount[b + 1] == 0) continue;
+            // duplicates this split would add must fit in the budget
+            const size_t added = size_t(left.count + rightCount[b + 1]) - refs.size();
+            if (references + added > maxReferences) continue;
+            const float cost = halfArea(left.min, left.max) * float(left.count) + rightCost[b + 1];
+            if (cost < best.cost) {
+                best.cost = cost;
+                best.axis = axis;
+                best.pos = min[axis] + width * float(b + 1);
+                best.spatial = true;
+            }
+        }
+    }
+    return best;
+}
+
+void SpatialSplitBuilder::leaf(const int index, const glm::vec3 min, const glm::vec3 max, const std::vector<Reference>& refs) {
+    model.boundingBoxMin[index] = glm::vec4(min, -float(model.triangles.size()));
+    model.boundingBoxMax[index] = glm::vec4(max, -float(refs.size()));
+    for (const Reference& ref : refs) model.triangles.push_back(source[ref.tri]);
+}
+
+void SpatialSplitBuilder::split(const int rootIndex, std::vector<Reference>& rootRefs, const int rootDepth) {
+    struct Work {
+        int index;
+        std::vector<Reference> refs;
+        int depth;
+    };
+    // right pushed before left, so nodes and leaf triangles come out in the order a
+    // recursive build gives them without a call per level
+    std::vector<Work> work;
+    work.push_back({rootIndex, std::move(rootRefs), rootDepth});
+    while (!work.empty()) {
+        Work item = std::move(work.back());
+        work.pop_back();
+        const int index = item.index;
+        std::vector<Reference>& refs = item.refs;
+
+        glm::vec3 min(1e30f), max(-1e30f);
+        for (const Reference& ref : refs) {
+            min = glm::min(min, ref.min);
+            max = glm::max(max, ref.max);
+        }
+
+        Split best;
+        if (item.depth > 0 && refs.size() > 1) {
+            // stays empty (zero overlap) when no object split is found
+            glm::vec3 overlapMin(1e30f), overlapMax(-1e30f);
+            best = objectSplit(refs, overlapMin, overlapMax);
+            if (halfArea(overlapMin, overlapMax) > OVERLAP_THRESHOLD * rootArea) {
+                const Split spatial = spatialSplit(refs, min, max);
+                if (spatial.cost < best.cost) best = spatial;
+            }
+        }
+
+        // same stopping rule as BaseModel::split: only split when it beats the leaf
+        if (best.axis < 0 || best.cost >= halfArea(min, max) * float(refs.size())) {
+            leaf(index, min, max, refs);
+            continue;
+        }
+
+        std::vector<Reference> leftRefs, rightRefs;
+        for (const Reference& ref : refs) {
+            if (!best.spatial) {
+                ((ref.min[best.axis] + ref.max[best.axis]) * 0.5f < best.pos ? leftRefs : rightRefs).push_back(ref);
+            } else if (ref.max[best.axis] <= best.pos) {
+                leftRefs.push_back(ref);
+            } else if (ref.min[best.axis] >= best.pos) {
+                rightRefs.push_back(ref);
+            } else {
+                Reference part{};
+                if (clip(ref, best.axis, ref.min[best.axis], best.pos, part)) leftRefs.push_back(part);
+                if (clip(ref, best.axis, best.pos, ref.max[best.axis], part)) rightRefs.push_back(part);
+            }
+        }
+        if (leftRefs.empty() || rightRefs.empty()) {
+            // clipping can leave a side empty, fall back to a leaf
+            leaf(index, min, max, refs);
+            continue;
+        }
+        references += leftRefs.size() + rightRefs.size() - refs.size();
+        if (best.spatial) spatialSplits++;
+        std::vector<Reference>().swap(refs);
+
+        const int indexA = int(model.boundingBoxMin.size());
+        model.boundingBoxMin.resize(indexA + 2);
+        model.boundingBoxMax.resize(indexA + 2);
+        model.boundingBoxMin[index] = glm::vec4(min, float(indexA));
+        model.boundingBoxMax[index] = glm::vec4(max, float(indexA + 1));
+
+        work.push_back({indexA + 1, std::move(rightRefs), item.depth - 1});
+        work.push_back({indexA, std::move(leftRefs), item.depth - 1});
+    }
+}
+
+void SpatialSplitBuilder::build(const int depth, const float duplicationBudget) {
+    source = std::move(model.triangles);
+    model.triangles.clear();
+    model.boundingBoxMin.assign(1, glm::vec4(0));
+    model.boundingBoxMax.assign(1, glm::vec4(0));
+
+    std::vector<Reference> refs;
+    refs.reserve(source.size());
+    glm::vec3 rootMin(1e30f), rootMax(-1e30f);
+    for (int i = 0; i < int(source.size()); ++i) {
+        const glm::ivec3 tri = source[i];
+        Reference ref{i, model.vertices[tri.x], model.vertices[tri.x]};
+        for (const int v : {tri.y, tri.z}) {
+            ref.min = glm::min(ref.min, model.vertices[v]);
+            ref.max = glm::max(ref.max, model.vertices[v]);
+        }
+        rootMin = glm::min(rootMin, ref.min);
+        rootMax = glm::max(rootMax, ref.max);
+        refs.push_back(ref);
+    }
+
+    references = refs.size();
+    maxReferences = size_t(double(refs.size()) * (1.0 + std::max(0.0f, duplicationBudget)));
+    rootArea = halfArea(rootMin, rootMax);
+    spatialSplits = 0;
+
+    split(0, refs, depth);
+
+    std::cout << "SBVH: " << source.size() << " triangles, " << model.triangles.size() << " references (+"
+              << 100.0 * (double(model.triangles.size()) / double(std::max<size_t>(1, source.size())) - 1.0)
+              << "%), " << spatialSplits << " spatial splits" << std::endl;
+    std::vector<glm::ivec3>().swap(source);
+}
@@ -0,0 +1,57 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef SPATIALSPLITBUILDER_H
+#define SPATIALSPLITBUILDER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "BaseModel.h"
+
+// SBVH builder (Stich et al. 2009). Next to binned object splits it tries
+// spatial splits that clip straddling triangles into both children, which
+// keeps long, thin triangles from inflating sibling boxes. A clipped triangle
+// is referenced from both leaves, so the triangle array grows; the budget
+// caps that growth as a fraction of the input triangle count. The output uses
+// the same node and leaf encoding as BaseModel::createBVH.
+class SpatialSplitBuilder {
+    struct Reference {
+        int tri;
+        glm::vec3 min, max;
+    };
+
+    struct Split {
+        float cost = 1e30f;
+        int axis = -1;
+        float pos = 0;
+        bool spatial = false;
+    };
+
+    BaseModel& model;
+    std::vector<glm::ivec3> source;
+    size_t maxReferences = 0;
+    size_t references = 0;
+    float rootArea = 0;
+    int spatialSplits = 0;
+
+    Split objectSplit(const std::vector<Reference>& refs, glm::vec3& overlapMin, glm::vec3& overlapMax) const;
+
+    Split spatialSplit(const std::vector<Reference>& refs, glm::vec3 min, glm::vec3 max) const;
+
+    // bounds of the part of a triangle inside the reference box and the slab [lo, hi] on axis
+    [[nodiscard]] bool clip(const Reference& ref, int axis, float lo, float hi, Reference& out) const;
+
+    void leaf(int index, glm::vec3 min, glm::vec3 max, const std::vector<Reference>& refs);
+
+    // builds the tree below rootIndex from rootRefs, which it consumes
+    void split(int rootIndex, std::vector<Reference>& rootRefs, int rootDepth);
+
+    public:
+    explicit SpatialSplitBuilder(BaseModel& model);
+
+    // replaces the model's triangles and nodes, triangles must hold the parsed input
+    void build(int depth, float duplicationBudget);
+};
+
+#endif //SPATIALSPLITBUILDER_H
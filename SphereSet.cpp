@@ -0,0 +1,56 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "SphereSet.h"
+#include "PLOCBuilder.h"
+#include "Refit.h"
+#include "TreeOptimizer.h"
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+SphereSet::SphereSet() = default;
+
+SphereSet::SphereSet(std::vector<glm::vec4> spheres, const BuildOptions& options) : spheres(std::move(spheres)) {
+    build(options);
+}
+
+void SphereSet::build(const BuildOptions& options) {
+    boundingBoxMin.clear();
+    boundingBoxMax.clear();
+    if (spheres.empty()) return;
+
+    // the builders see each sphere as a triangle slot holding its index, with its box as the reference bounds
+    const int count = int(spheres.size());
+    BaseModel model;
+    model.triangles.reserve(count);
+    model.referenceMin.reserve(count);
+    model.referenceMax.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const glm::vec3 center(spheres[i]);
+        model.triangles.emplace_back(i);
+        model.referenceMin.push_back(center - spheres[i].w);
+        model.referenceMax.push_back(center + spheres[i].w);
+    }
+
+    const int depth = options.maxDepth > 0 ? options.maxDepth : std::numeric_limits<int>::max();
+    const auto buildStart = std::chrono::steady_clock::now();
+    if (options.builder == Builder::PLOC) {
+        PLOCBuilder(model).build();
+    } else {
+        model.createBVH(depth, 5, 0, count);
+    }
+    std::cout << "Spheres: " << count << ", BVH build " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count()
+              << " ms, SAH cost " << treeCost(model.boundingBoxMin.data(), model.boundingBoxMax.data(), 0) << ", depth "
+              << treeDepth(model.boundingBoxMin.data(), model.boundingBoxMax.data(), 0) << std::endl;
+    if (options.optimizeMs > 0) TreeOptimizer(model).optimize(options.optimizeMs);
+    model.reorderNodes(options.order);
+
+    std::vector<glm::vec4> ordered(count);
+    for (int i = 0; i < count; ++i) ordered[i] = spheres[model.triangles[i].x];
+    spheres = std::move(ordered);
+    boundingBoxMin = std::move(model.boundingBoxMin);
+    boundingBoxMax = std::move(model.boundingBoxMax);
+}
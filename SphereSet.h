@@ -0,0 +1,36 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef SPHERESET_H
+#define SPHERESET_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "BaseModel.h"
+
+// Analytic spheres as a primitive of their own, one vec4 (center, radius) each
+// instead of a tessellated mesh. A set is built by the model builders over the
+// spheres' boxes, passed in as BaseModel reference bounds, and keeps their node
+// encoding, except that leaves index spheres rather than triangles. Scene traces
+// sets with the SPHERES shader variant, which intersects them analytically.
+class SphereSet {
+    public:
+
+    // center and radius, in leaf order once built
+    std::vector<glm::vec4> spheres;
+
+    std::vector<glm::vec4> boundingBoxMin;
+    std::vector<glm::vec4> boundingBoxMax;
+
+    SphereSet();
+
+    explicit SphereSet(std::vector<glm::vec4> spheres, const BuildOptions& options = {});
+
+    // builds the BVH and puts the spheres in leaf order. The SBVH clips
+    // triangles, so the binned builder takes its place; cleanup and early
+    // split don't apply to spheres
+    void build(const BuildOptions& options = {});
+};
+
+#endif //SPHERESET_H
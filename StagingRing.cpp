@@ -0,0 +1,96 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "StagingRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "Shader.h"
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (GLAD_API_PTR *PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+void StagingRing::init(const GLADloadfunc load, const size_t segmentSize, const int segments) {
+    release();
+    this->segmentSize = segmentSize;
+    fences.assign(size_t(std::max(segments, 1)), nullptr);
+    next = 0;
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    const bool core = major > 4 || (major == 4 && minor >= 4);
+    const char* name = core ? "glBufferStorage" : hasExtension("GL_ARB_buffer_storage") ? "glBufferStorage" : nullptr;
+    const auto bufferStorage = name != nullptr ? reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(load(name)) : nullptr;
+
+    if (bufferStorage != nullptr) {
+        constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const size_t size = segmentSize * fences.size();
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        bufferStorage(GL_COPY_READ_BUFFER, GLsizeiptr(size), nullptr, flags);
+        mapped = static_cast<char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, GLsizeiptr(size), flags));
+        if (mapped == nullptr) {
+            glDeleteBuffers(1, &buffer);
+            buffer = 0;
+        }
+    }
+
+    std::cout << "Staging: " << fences.size() << " x " << (segmentSize >> 10) << " KB, "
+              << (mapped != nullptr ? "persistent mapping" : "chunked glBufferSubData") << std::endl;
+}
+
+void StagingRing::upload(const GLuint target, const size_t offset, const void* data, const size_t bytes) {
+    const auto src = static_cast<const char*>(data);
+    for (size_t done = 0; done < bytes;) {
+        const size_t chunk = segmentSize == 0 ? bytes - done : std::min(segmentSize, bytes - done);
+
+        if (mapped == nullptr) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, target);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(offset + done), GLsizeiptr(chunk), src + done);
+            done += chunk;
+            continue;
+        }
+
+        // the segment is reused only once the copy that last read it has finished
+        GLsync& fence = fences[next];
+        if (fence != nullptr) {
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(fence);
+        }
+
+        const size_t staged = next * segmentSize;
+        std::memcpy(mapped + staged, src + done, chunk);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, target);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(staged), GLintptr(offset + done), GLsizeiptr(chunk));
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        next = (next + 1) % fences.size();
+        done += chunk;
+    }
+}
+
+void StagingRing::release() {
+    for (GLsync& fence : fences) {
+        if (fence != nullptr) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (buffer != 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    mapped = nullptr;
+}
+
+bool StagingRing::isPersistent() const {
+    return mapped != nullptr;
+}
@@ -0,0 +1,39 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef STAGINGRING_H
+#define STAGINGRING_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// Fixed-size upload staging memory. With GL 4.4 / ARB_buffer_storage it is one
+// persistently mapped buffer split into segments, each guarded by a fence, and
+// data reaches its destination through glCopyBufferSubData. Without it uploads
+// fall back to glBufferSubData in segment-sized chunks. Either way the driver
+// never has to stage more than one segment of any upload at a time.
+class StagingRing {
+    GLuint buffer = 0;
+    char* mapped = nullptr;
+    size_t segmentSize = 0;
+    std::vector<GLsync> fences;
+    size_t next = 0;
+
+    public:
+    StagingRing() = default;
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    void init(GLADloadfunc load, size_t segmentSize = size_t(8) << 20, int segments = 4);
+
+    // copies bytes from data into target at offset, one segment at a time
+    void upload(GLuint target, size_t offset, const void* data, size_t bytes);
+
+    void release();
+
+    [[nodiscard]] bool isPersistent() const;
+};
+
+#endif //STAGINGRING_H
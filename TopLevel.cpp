@@ -0,0 +1,118 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "TopLevel.h"
+
+#include <algorithm>
+
+constexpr int TOP_LEVEL_BINS = 8;
+constexpr int TOP_LEVEL_LEAF = 2;
+
+struct TopLevelBuild {
+    const std::vector<glm::vec3>& boxMin;
+    const std::vector<glm::vec3>& boxMax;
+    std::vector<int>& order;
+    std::vector<glm::vec4>& nodes;
+
+    static float area(const glm::vec3 min, const glm::vec3 max) {
+        const glm::vec3 size = glm::max(max - min, glm::vec3(0));
+        return size.x * (size.y + size.z) + size.y * size.z;
+    }
+
+    void bounds(const int first, const int count, glm::vec3& min, glm::vec3& max) const {
+        min = glm::vec3(1e30f);
+        max = glm::vec3(-1e30f);
+        for (int i = first; i < first + count; ++i) {
+            min = glm::min(min, boxMin[order[i]]);
+            max = glm::max(max, boxMax[order[i]]);
+        }
+    }
+
+    // binned SAH over box centroids, returns the number of instances that go left or 0 for a leaf
+    [[nodiscard]] int partition(const int first, const int count, const glm::vec3 min, const glm::vec3 max) const {
+        if (count <= TOP_LEVEL_LEAF) return 0;
+
+        glm::vec3 centroidMin(1e30f), centroidMax(-1e30f);
+        for (int i = first; i < first + count; ++i) {
+            const glm::vec3 centroid = (boxMin[order[i]] + boxMax[order[i]]) * 0.5f;
+            centroidMin = glm::min(centroidMin, centroid);
+            centroidMax = glm::max(centroidMax, centroid);
+        }
+        const glm::vec3 extent = centroidMax - centroidMin;
+        const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        if (extent[axis] <= 0) return 0;
+
+        struct Bin {
+            glm::vec3 min{1e30f}, max{-1e30f};
+            int count = 0;
+        };
+        Bin bins[TOP_LEVEL_BINS];
+        const float scale = TOP_LEVEL_BINS / extent[axis];
+        const auto binOf = [&](const int instance) {
+            const float centroid = (boxMin[instance][axis] + boxMax[instance][axis]) * 0.5f;
+            return std::min(TOP_LEVEL_BINS - 1, int((centroid - centroidMin[axis]) * scale));
+        };
+        for (int i = first; i < first + count; ++i) {
+            Bin& bin = bins[binOf(order[i])];
+            bin.min = glm::min(bin.min, boxMin[order[i]]);
+            bin.max = glm::max(bin.max, boxMax[order[i]]);
+            bin.count++;
+        }
+
+        float rightCost[TOP_LEVEL_BINS];
+        Bin right;
+        for (int b = TOP_LEVEL_BINS - 1; b > 0; --b) {
+            right.min = glm::min(right.min, bins[b].min);
+            right.max = glm::max(right.max, bins[b].max);
+            right.count += bins[b].count;
+            rightCost[b] = area(right.min, right.max) * float(right.count);
+        }
+        Bin left;
+        int bestBin = -1;
+        float bestCost = area(min, max) * float(count);
+        for (int b = 0; b < TOP_LEVEL_BINS - 1; ++b) {
+            left.min = glm::min(left.min, bins[b].min);
+            left.max = glm::max(left.max, bins[b].max);
+            left.count += bins[b].count;
+            if (left.count == 0 || left.count == count) continue;
+            const float cost = area(left.min, left.max) * float(left.count) + rightCost[b + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestBin = b;
+            }
+        }
+        if (bestBin < 0) return 0;
+
+        const auto middle = std::partition(order.begin() + first, order.begin() + first + count,
+                                           [&](const int instance) { return binOf(instance) <= bestBin; });
+        return int(middle - (order.begin() + first));
+    }
+
+    void build(const int node, const int first, const int count) {
+        glm::vec3 min, max;
+        bounds(first, count, min, max);
+        const int leftCount = partition(first, count, min, max);
+        if (leftCount == 0) {
+            nodes[node * 2 + 0] = glm::vec4(min, -first);
+            nodes[node * 2 + 1] = glm::vec4(max, -count);
+            return;
+        }
+
+        const int childA = int(nodes.size() / 2);
+        nodes.resize(nodes.size() + 4);
+        nodes[node * 2 + 0] = glm::vec4(min, childA);
+        nodes[node * 2 + 1] = glm::vec4(max, childA + 1);
+        build(childA, first, leftCount);
+        build(childA + 1, first + leftCount, count - leftCount);
+    }
+};
+
+void buildTopLevel(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax,
+                   std::vector<int>& order, std::vector<glm::vec4>& nodes) {
+    const int count = int(boxMin.size());
+    order.resize(count);
+    for (int i = 0; i < count; ++i) order[i] = i;
+    nodes.assign(2, glm::vec4(0));
+    TopLevelBuild{boxMin, boxMax, order, nodes}.build(0, 0, count);
+}
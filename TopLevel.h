@@ -0,0 +1,30 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef TOPLEVEL_H
+#define TOPLEVEL_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// One placed copy of a model as the shader reads it (binding 12). The rows are
+// the affine world to model transform, so a ray is moved into the model's BVH
+// without renormalizing and hit distances stay in world units; the same rows
+// transposed take hit normals back out.
+//   info x: float BVH root, y: quantized root record, z: model index
+struct InstanceRecord {
+    glm::vec4 worldToModel[3];
+    glm::ivec4 info;
+};
+
+// Small BVH over instance boxes, rebuilt from scratch every time instances
+// move; a few hundred of them build in well under a millisecond. Nodes use
+// the model encoding (two vec4 per node, interleaved min then max): a leaf
+// has min.w = -first and max.w = -count over order, an interior node the
+// indices of its two children, which are stored as an adjacent pair.
+// order receives the instance indices in leaf order, node 0 is the root.
+void buildTopLevel(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax,
+                   std::vector<int>& order, std::vector<glm::vec4>& nodes);
+
+#endif //TOPLEVEL_H
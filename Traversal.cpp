@@ -0,0 +1,227 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "Traversal.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr int STACK_SIZE = 64;
+
+CacheModel::CacheModel(const size_t bytes, const int ways, const int lineBytes) : ways(ways), lineShift(0) {
+    while ((1 << lineShift) < lineBytes) lineShift++;
+    sets = std::max<size_t>(1, bytes / (size_t(lineBytes) * ways));
+    lines.assign(sets * ways, ~uintptr_t(0));
+}
+
+void CacheModel::access(const void* address, const size_t bytes) {
+    const uintptr_t first = reinterpret_cast<uintptr_t>(address) >> lineShift;
+    const uintptr_t last = (reinterpret_cast<uintptr_t>(address) + bytes - 1) >> lineShift;
+    for (uintptr_t line = first; line <= last; ++line) {
+        accesses++;
+        uintptr_t* set = &lines[(line % sets) * ways];
+        int way = 0;
+        while (way < ways && set[way] != line) way++;
+        if (way == ways) {
+            misses++;
+            way = ways - 1;
+        }
+        for (; way > 0; --way) set[way] = set[way - 1];
+        set[0] = line;
+    }
+}
+
+void touch(const RayHit& hit, const void* address, const size_t bytes) {
+    if (hit.cache != nullptr) hit.cache->access(address, bytes);
+}
+
+bool intersectTriangle(const glm::vec3 origin, const glm::vec3 dir, const glm::vec3 v0, const glm::vec3 v1, const glm::vec3 v2, float& t) {
+    constexpr float EPSILON = 0.01f;
+    const glm::vec3 edge1 = v1 - v0;
+    const glm::vec3 edge2 = v2 - v0;
+
+    const glm::vec3 pvec = glm::cross(dir, edge2);
+    const float det = glm::dot(edge1, pvec);
+    if (std::abs(det) < EPSILON) return false;
+
+    const float invDet = 1.0f / det;
+    const glm::vec3 tvec = origin - v0;
+    const float u = glm::dot(tvec, pvec) * invDet;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    const glm::vec3 qvec = glm::cross(tvec, edge1);
+    const float v = glm::dot(dir, qvec) * invDet;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    t = glm::dot(edge2, qvec) * invDet;
+    return t >= 0.1f;
+}
+
+float intersectAABB(const glm::vec3 origin, const glm::vec3 invDir, const glm::vec3 boxMin, const glm::vec3 boxMax) {
+    const glm::vec3 t0 = (boxMin - origin) * invDir;
+    const glm::vec3 t1 = (boxMax - origin) * invDir;
+    const glm::vec3 tNear = glm::min(t0, t1);
+    const glm::vec3 tFar = glm::max(t0, t1);
+    const float tMin = glm::max(glm::max(tNear.x, tNear.y), tNear.z);
+    const float tMax = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+    return tMax >= glm::max(tMin, 0.0f) ? tMin : 1000000000;
+}
+
+void intersectLeaf(const glm::ivec4* triangles, const glm::vec4* vertices, const int triStart, const int numTris,
+                   const glm::vec3 origin, const glm::vec3 dir, RayHit& hit) {
+    for (int j = triStart; j < triStart + numTris; ++j) {
+        hit.triTests++;
+        const glm::ivec4 tri = triangles[j];
+        touch(hit, &triangles[j], sizeof(glm::ivec4));
+        touch(hit, &vertices[tri.x], sizeof(glm::vec4));
+        touch(hit, &vertices[tri.y], sizeof(glm::vec4));
+        touch(hit, &vertices[tri.z], sizeof(glm::vec4));
+        float t;
+        if (!intersectTriangle(origin, dir, glm::vec3(vertices[tri.x]), glm::vec3(vertices[tri.y]), glm::vec3(vertices[tri.z]), t)) continue;
+        if (t < hit.t) {
+            hit.t = t;
+            hit.tri = j;
+        }
+    }
+}
+
+// same bound as the shader's fixed stack, a full stack drops the node and counts it
+void push(int (&stack)[STACK_SIZE], int& stackPtr, const int node, RayHit& hit) {
+    if (stackPtr < STACK_SIZE) stack[stackPtr++] = node;
+    else hit.overflows++;
+}
+
+void traverseBinary(const glm::vec4* bboxMin, const glm::vec4* bboxMax, const glm::ivec4* triangles, const glm::vec4* vertices,
+                    const int root, const glm::vec3 origin, const glm::vec3 dir, RayHit& hit) {
+    const glm::vec3 invDir = 1.0f / dir;
+    int stack[STACK_SIZE];
+    int stackPtr = 0;
+    stack[stackPtr++] = root;
+
+    while (stackPtr > 0) {
+        const int index = stack[--stackPtr];
+        const glm::vec4 nodeMin = bboxMin[index];
+        const glm::vec4 nodeMax = bboxMax[index];
+        touch(hit, &bboxMin[index], sizeof(glm::vec4));
+        touch(hit, &bboxMax[index], sizeof(glm::vec4));
+
+        if (nodeMin.w <= 0) {
+            intersectLeaf(triangles, vertices, -int(nodeMin.w), -int(nodeMax.w), origin, dir, hit);
+            continue;
+        }
+
+        const int childA = int(nodeMin.w);
+        const int childB = int(nodeMax.w);
+        hit.nodeTests += 2;
+        touch(hit, &bboxMin[childA], sizeof(glm::vec4));
+        touch(hit, &bboxMax[childA], sizeof(glm::vec4));
+        touch(hit, &bboxMin[childB], sizeof(glm::vec4));
+        touch(hit, &bboxMax[childB], sizeof(glm::vec4));
+        const float disA = intersectAABB(origin, invDir, glm::vec3(bboxMin[childA]), glm::vec3(bboxMax[childA]));
+        const float disB = intersectAABB(origin, invDir, glm::vec3(bboxMin[childB]), glm::vec3(bboxMax[childB]));
+
+        const bool nearA = disA <= disB;
+        const float disNear = nearA ? disA : disB;
+        const float disFar = nearA ? disB : disA;
+        if (disFar < hit.t) push(stack, stackPtr, nearA ? childB : childA, hit);
+        if (disNear < hit.t) push(stack, stackPtr, nearA ? childA : childB, hit);
+    }
+}
+
+// child of node visited first, by the same test as the shader's nearChild()
+int nearChild(const glm::vec4* bboxMin, const glm::vec4* bboxMax, const int node, const glm::vec3 dir, const RayHit& hit) {
+    const int a = int(bboxMin[node].w);
+    const int b = int(bboxMax[node].w);
+    touch(hit, &bboxMin[a], sizeof(glm::vec4));
+    touch(hit, &bboxMax[a], sizeof(glm::vec4));
+    touch(hit, &bboxMin[b], sizeof(glm::vec4));
+    touch(hit, &bboxMax[b], sizeof(glm::vec4));
+    const glm::vec3 centerA = glm::vec3(bboxMin[a]) + glm::vec3(bboxMax[a]);
+    const glm::vec3 centerB = glm::vec3(bboxMin[b]) + glm::vec3(bboxMax[b]);
+    return glm::dot(centerA - centerB, dir) <= 0 ? a : b;
+}
+
+void traverseStackless(const glm::vec4* bboxMin, const glm::vec4* bboxMax, const int* parents, const glm::ivec4* triangles,
+                       const glm::vec4* vertices, const int root, const glm::vec3 origin, const glm::vec3 dir, RayHit& hit) {
+    if (bboxMin[root].w <= 0) {
+        intersectLeaf(triangles, vertices, -int(bboxMin[root].w), -int(bboxMax[root].w), origin, dir, hit);
+        return;
+    }
+    const glm::vec3 invDir = 1.0f / dir;
+    const auto sibling = [&](const int node, const int parent) {
+        const int a = int(bboxMin[parent].w);
+        return a == node ? int(bboxMax[parent].w) : a;
+    };
+    enum { FromParent, FromSibling, FromChild } state = FromParent;
+    int current = nearChild(bboxMin, bboxMax, root, dir, hit);
+
+    while (true) {
+        if (state == FromChild) {
+            if (current == root) return;
+            touch(hit, &parents[current], sizeof(int));
+            const int parent = parents[current];
+            if (current == nearChild(bboxMin, bboxMax, parent, dir, hit)) {
+                current = sibling(current, parent);
+                state = FromSibling;
+            } else {
+                current = parent;
+            }
+            continue;
+        }
+
+        const glm::vec4 nodeMin = bboxMin[current];
+        const glm::vec4 nodeMax = bboxMax[current];
+        touch(hit, &bboxMin[current], sizeof(glm::vec4));
+        touch(hit, &bboxMax[current], sizeof(glm::vec4));
+        hit.nodeTests++;
+        const bool entered = intersectAABB(origin, invDir, glm::vec3(nodeMin), glm::vec3(nodeMax)) < hit.t;
+        if (entered && nodeMin.w > 0) {
+            current = nearChild(bboxMin, bboxMax, current, dir, hit);
+            state = FromParent;
+            continue;
+        }
+        if (entered) intersectLeaf(triangles, vertices, -int(nodeMin.w), -int(nodeMax.w), origin, dir, hit);
+
+        touch(hit, &parents[current], sizeof(int));
+        if (state == FromParent) {
+            current = sibling(current, parents[current]);
+            state = FromSibling;
+        } else {
+            current = parents[current];
+            state = FromChild;
+        }
+    }
+}
+
+void traverseQuantized(const QuantizedNode* nodes, const glm::ivec4* triangles, const glm::vec4* vertices,
+                       const int root, const glm::vec3 origin, const glm::vec3 dir, RayHit& hit) {
+    const glm::vec3 invDir = 1.0f / dir;
+    int stack[STACK_SIZE];
+    int stackPtr = 0;
+    stack[stackPtr++] = root;
+
+    while (stackPtr > 0) {
+        const QuantizedNode& node = nodes[stack[--stackPtr]];
+        touch(hit, &node, sizeof(QuantizedNode));
+
+        glm::vec3 minA, maxA, minB, maxB;
+        decodeChild(node, 0, minA, maxA);
+        decodeChild(node, 1, minB, maxB);
+        hit.nodeTests += 2;
+        const float disA = intersectAABB(origin, invDir, minA, maxA);
+        const float disB = intersectAABB(origin, invDir, minB, maxB);
+
+        const bool nearA = disA <= disB;
+        const float disNear = nearA ? disA : disB;
+        const float disFar = nearA ? disB : disA;
+        const glm::ivec2 near = nearA ? glm::ivec2(node.children.x, node.children.y) : glm::ivec2(node.children.z, node.children.w);
+        const glm::ivec2 far = nearA ? glm::ivec2(node.children.z, node.children.w) : glm::ivec2(node.children.x, node.children.y);
+
+        // leaf children are tested right away, nearest first, so the far test can use the new hit
+        if (disNear < hit.t && near.y >= 0) intersectLeaf(triangles, vertices, near.x, near.y, origin, dir, hit);
+        if (disFar < hit.t && far.y >= 0) intersectLeaf(triangles, vertices, far.x, far.y, origin, dir, hit);
+        if (disFar < hit.t && far.y < 0) push(stack, stackPtr, far.x, hit);
+        if (disNear < hit.t && near.y < 0) push(stack, stackPtr, near.x, hit);
+    }
+}
@@ -0,0 +1,59 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef TRAVERSAL_H
+#define TRAVERSAL_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "QuantizedBVH.h"
+
+// Set-associative LRU cache model. Traversals report every load to it so
+// memory layouts can be compared by misses, which wall time on a machine
+// with big caches hides.
+class CacheModel {
+    std::vector<uintptr_t> lines;  // per set, most recently used first
+    size_t sets;
+    int ways;
+    int lineShift;
+
+    public:
+    size_t accesses = 0;
+    size_t misses = 0;
+
+    explicit CacheModel(size_t bytes = size_t(32) << 10, int ways = 8, int lineBytes = 64);
+
+    void access(const void* address, size_t bytes);
+};
+
+// CPU mirrors of the shader's closest-hit traversal, for benchmarks and for
+// checking node layouts against each other. Hit tests use the same epsilons as
+// fullscreen.frag so both sides agree on which triangle is hit.
+struct RayHit {
+    float t = 1000000000;
+    int tri = -1;
+    int nodeTests = 0;
+    int triTests = 0;
+    // pushes dropped because the stack was full
+    int overflows = 0;
+    CacheModel* cache = nullptr;
+};
+
+bool intersectTriangle(glm::vec3 origin, glm::vec3 dir, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, float& t);
+
+float intersectAABB(glm::vec3 origin, glm::vec3 invDir, glm::vec3 boxMin, glm::vec3 boxMax);
+
+void traverseBinary(const glm::vec4* bboxMin, const glm::vec4* bboxMax, const glm::ivec4* triangles, const glm::vec4* vertices,
+                    int root, glm::vec3 origin, glm::vec3 dir, RayHit& hit);
+
+// traverseBinary without a stack, walking back up through parents (-1 at roots)
+void traverseStackless(const glm::vec4* bboxMin, const glm::vec4* bboxMax, const int* parents, const glm::ivec4* triangles,
+                       const glm::vec4* vertices, int root, glm::vec3 origin, glm::vec3 dir, RayHit& hit);
+
+void traverseQuantized(const QuantizedNode* nodes, const glm::ivec4* triangles, const glm::vec4* vertices,
+                       int root, glm::vec3 origin, glm::vec3 dir, RayHit& hit);
+
+#endif //TRAVERSAL_H
@@ -0,0 +1,178 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#include "TreeOptimizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "Refit.h"
+
+using OptimizeClock = std::chrono::steady_clock;
+
+float boxArea(const glm::vec4& min, const glm::vec4& max) {
+    const glm::vec3 size = glm::max(glm::vec3(max - min), glm::vec3(0));
+    return size.x * (size.y + size.z) + size.y * size.z;
+}
+
+// index of the lowest set bit
+int lowestBit(const int mask) {
+    int bit = 0;
+    while ((mask >> bit & 1) == 0) bit++;
+    return bit;
+}
+
+TreeOptimizer::TreeOptimizer(BaseModel& model) : model(model) {}
+
+float TreeOptimizer::restructure(const int node) {
+    std::vector<glm::vec4>& bboxMin = model.boundingBoxMin;
+    std::vector<glm::vec4>& bboxMax = model.boundingBoxMax;
+    if (bboxMin[node].w <= 0) return 0;
+    const auto area = [&](const int i) { return boxArea(bboxMin[i], bboxMax[i]); };
+
+    // grow the treelet by opening its largest leaf, the interior nodes give up their child slots
+    int leaves[TREELET_LEAVES] = {int(bboxMin[node].w), int(bboxMax[node].w)};
+    int slots[TREELET_LEAVES - 1][2] = {{leaves[0], leaves[1]}};
+    int numLeaves = 2, numSlots = 1;
+    float oldArea = area(node);
+    while (numLeaves < TREELET_LEAVES) {
+        int largest = -1;
+        float largestArea = -1;
+        for (int i = 0; i < numLeaves; ++i) {
+            if (bboxMin[leaves[i]].w <= 0 || area(leaves[i]) <= largestArea) continue;
+            largest = i;
+            largestArea = area(leaves[i]);
+        }
+        if (largest < 0) break;
+        const int opened = leaves[largest];
+        oldArea += largestArea;
+        slots[numSlots][0] = int(bboxMin[opened].w);
+        slots[numSlots][1] = int(bboxMax[opened].w);
+        leaves[largest] = slots[numSlots][0];
+        leaves[numLeaves++] = slots[numSlots][1];
+        numSlots++;
+    }
+    if (numLeaves < 3) return 0;
+
+    // cheapest tree over every subset of the leaves, a subset's cost being the area of its interior nodes
+    constexpr int MAX_SUBSETS = 1 << TREELET_LEAVES;
+    glm::vec4 subsetMin[MAX_SUBSETS], subsetMax[MAX_SUBSETS];
+    float cost[MAX_SUBSETS];
+    int partition[MAX_SUBSETS];
+    const int full = (1 << numLeaves) - 1;
+    for (int mask = 1; mask <= full; ++mask) {
+        const int low = mask & -mask;
+        if (mask == low) {
+            const int leaf = leaves[lowestBit(mask)];
+            subsetMin[mask] = bboxMin[leaf];
+            subsetMax[mask] = bboxMax[leaf];
+            cost[mask] = 0;
+            continue;
+        }
+        subsetMin[mask] = glm::min(subsetMin[low], subsetMin[mask ^ low]);
+        subsetMax[mask] = glm::max(subsetMax[low], subsetMax[mask ^ low]);
+        // every split into two halves once, by keeping the lowest leaf on the first side
+        float best = 1e30f;
+        for (int sub = (mask - 1) & mask; sub > 0; sub = (sub - 1) & mask) {
+            if ((sub & low) == 0) continue;
+            const float c = cost[sub] + cost[mask ^ sub];
+            if (c < best) {
+                best = c;
+                partition[mask] = sub;
+            }
+        }
+        cost[mask] = boxArea(subsetMin[mask], subsetMax[mask]) + best;
+    }
+
+    const float gain = oldArea - cost[full];
+    if (gain <= 1e-6f * area(node)) return 0;
+
+    glm::vec4 leafMin[TREELET_LEAVES], leafMax[TREELET_LEAVES];
+    for (int i = 0; i < numLeaves; ++i) {
+        leafMin[i] = bboxMin[leaves[i]];
+        leafMax[i] = bboxMax[leaves[i]];
+    }
+    int nextSlot = 0;
+    const auto emit = [&](auto&& self, const int mask, const int position) -> void {
+        if ((mask & (mask - 1)) == 0) {
+            const int leaf = lowestBit(mask);
+            bboxMin[position] = leafMin[leaf];
+            bboxMax[position] = leafMax[leaf];
+            return;
+        }
+        const int* slot = slots[nextSlot++];
+        bboxMin[position] = glm::vec4(glm::vec3(subsetMin[mask]), float(slot[0]));
+        bboxMax[position] = glm::vec4(glm::vec3(subsetMax[mask]), float(slot[1]));
+        self(self, partition[mask], slot[0]);
+        self(self, mask ^ partition[mask], slot[1]);
+    };
+    emit(emit, full, node);
+    return gain;
+}
+
+void TreeOptimizer::optimizeSubtree(const int root, std::vector<int>& order) {
+    // interior nodes in reverse preorder, so children come before their parent
+    order.clear();
+    std::vector<int> stack = {root};
+    while (!stack.empty()) {
+        const int node = stack.back();
+        stack.pop_back();
+        if (model.boundingBoxMin[node].w <= 0) continue;
+        order.push_back(node);
+        stack.push_back(int(model.boundingBoxMin[node].w));
+        stack.push_back(int(model.boundingBoxMax[node].w));
+    }
+    for (auto node = order.rbegin(); node != order.rend(); ++node) restructure(*node);
+}
+
+void TreeOptimizer::optimize(const double budgetMs) {
+    if (model.boundingBoxMin.empty() || budgetMs <= 0) return;
+    const auto start = OptimizeClock::now();
+    const auto deadline = start + std::chrono::duration<double, std::milli>(budgetMs);
+    const float before = treeCost(model.boundingBoxMin.data(), model.boundingBoxMax.data(), 0);
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    float cost = before;
+    int passes = 0;
+    while (OptimizeClock::now() < deadline) {
+        // treelets above the cut move subtrees around, so it is found again every pass
+        std::vector<int> top, cut = {0};
+        while (cut.size() < threads * 4) {
+            std::vector<int> next;
+            for (const int node : cut) {
+                if (model.boundingBoxMin[node].w <= 0) continue;
+                top.push_back(node);
+                next.push_back(int(model.boundingBoxMin[node].w));
+                next.push_back(int(model.boundingBoxMax[node].w));
+            }
+            if (next.empty()) break;
+            cut = std::move(next);
+        }
+
+        std::atomic<size_t> nextSubtree{0};
+        const auto worker = [&] {
+            std::vector<int> order;
+            for (size_t i = nextSubtree++; i < cut.size() && OptimizeClock::now() < deadline; i = nextSubtree++) {
+                optimizeSubtree(cut[i], order);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threads; ++t) workers.emplace_back(worker);
+        worker();
+        for (std::thread& thread : workers) thread.join();
+        for (auto node = top.rbegin(); node != top.rend(); ++node) restructure(*node);
+        passes++;
+
+        const float after = treeCost(model.boundingBoxMin.data(), model.boundingBoxMax.data(), 0);
+        const bool converged = after > cost * 0.999f;
+        cost = after;
+        if (converged) break;
+    }
+
+    std::cout << "Treelets: SAH cost " << before << " -> " << cost << " (" << 100.0 * (cost / before - 1.0) << "%), "
+              << passes << " passes in " << std::chrono::duration<double, std::milli>(OptimizeClock::now() - start).count()
+              << " ms" << std::endl;
+}
@@ -0,0 +1,39 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef TREEOPTIMIZER_H
+#define TREEOPTIMIZER_H
+
+#include <vector>
+#include "BaseModel.h"
+
+// Post-build SAH optimization by treelet restructuring (Karras and Aila 2013).
+// A treelet is a node plus the descendants reached by repeatedly opening its
+// largest treelet leaf, up to TREELET_LEAVES leaves. Every binary tree over
+// those leaves is searched by dynamic programming over leaf subsets, and the
+// cheapest replaces the treelet if it lowers the summed area of its interior
+// nodes, which is all the SAH cost it can change. The new interior nodes reuse
+// the old ones' child slots, so siblings stay in the pairs the builders made.
+//
+// Passes go bottom-up until one stops paying or the time budget runs out.
+// Subtrees below a cut are disjoint, so each pass optimizes them on all
+// hardware threads and then the few nodes above the cut on one.
+class TreeOptimizer {
+    static constexpr int TREELET_LEAVES = 7;
+
+    BaseModel& model;
+
+    // restructures the treelet rooted at node if that pays, returns the area saved
+    float restructure(int node);
+
+    void optimizeSubtree(int root, std::vector<int>& order);
+
+    public:
+    explicit TreeOptimizer(BaseModel& model);
+
+    // nodes must be in the builder's encoding with the root at 0
+    void optimize(double budgetMs);
+};
+
+#endif //TREEOPTIMIZER_H
@@ -0,0 +1,60 @@
+//
+// Created by acroy on 10/19/2026.
+//
+
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Blocking multi-producer/multi-consumer queue connecting pipeline stages.
+// A capacity of 0 means unbounded; otherwise push() waits for room, which
+// keeps a fast stage from running far ahead of a slow one.
+template <typename T>
+class WorkQueue {
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t capacity;
+    bool closed = false;
+
+    public:
+    explicit WorkQueue(const size_t capacity = 0) : capacity(capacity) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return capacity == 0 || items.size() < capacity; });
+        items.push_back(std::move(item));
+        changed.notify_all();
+    }
+
+    // false once the queue is closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        changed.notify_all();
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        changed.notify_all();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        changed.notify_all();
+    }
+};
+
+#endif //WORKQUEUE_H
@@ -1,22 +1,107 @@
+#include <cmath>
+#include <cstdio>
 #include <ctime>
+#include <chrono>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <fstream>
+#include <random>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "CameraPath.h"
+#include "FrameCapture.h"
+#include "FrameProfiler.h"
+#include "ImageWriter.h"
+#include "ModelLoader.h"
+#include "ProgramCache.h"
+#include "ResolutionScaler.h"
 #include "Scene.h"
+#include "Shader.h"
+#include "ShaderVariants.h"
+#include "StagingRing.h"
+#ifdef HAS_EGL
+#include "Headless.h"
+#endif
 
+struct Options {
+    bool headless = false;
+    int frames = 64;
+    int width = 1280, height = 720;
+    std::string output = "headless.png";
+    std::string model = "dragon800K.txt";
+    std::string scene;
+    bool hasCamera = false;
+    glm::vec3 cameraPos{}, cameraForward{0, 0, -1};
+    std::string capture;
+    int captureFps = 30;
+    std::string record;
+    std::string replay;
+    std::string report;
+    bool hasSeed = false;
+    glm::uint seed = 0;
+    int variant = 0;
+    bool variantBench = false;
+    std::string shaderCache = "shadercache";
+    GeometryMode geometry = GeometryMode::Streaming;
+    NodeLayout nodeLayout = NodeLayout::Float;
+    TraversalMode traversal = TraversalMode::Stack;
+    TriangleLayout triangleLayout = TriangleLayout::Indexed;
+    int traversalBench = 0;
+    BuildOptions build;
+    bool animate = false;
+    RefitMode refit = RefitMode::Host;
+    float rebuildRatio = 1.5f;
+    bool instancing = false;
+    int objects = 0;
+    int particles = 0;
+    float lodPixelError = 1;
+    std::string paged;
+    int pageBudget = 256;
+    double targetMs = 0;
+    float minScale = 0.25f;
+};
 
 GLFWwindow* window = nullptr;
+#ifdef HAS_EGL
+HeadlessContext headlessContext;
+#endif
 GLuint shaderProgram = 0;
+ProgramCache programCache;
+ProgramCache::Pending displayPending;
+ShaderVariants traceVariants;
+// 0: generic, 1: specialized, 2: specialized heat map, cycled with V
+constexpr int NUM_VARIANTS = 3;
+int variant = 0;
+bool variantChanged = false;
+// P drops a prop in front of the camera, O removes the last one
+int propRequest = 0;
 GLuint displayShader = 0;
+ProgramCache::Pending upscalePending;
+GLuint upscaleShader = 0;
+GLuint refitProgram = 0;
 GLuint vao = 0;
 
 GLuint pingpongFBO[2];
 GLuint pingpongTex[2];
+// dynamic resolution: the scaler picks the trace size, the upscale pass brings
+// frames traced smaller back to the output size through linearSampler
+ResolutionScaler scaler;
+GLuint upscaleFBO = 0;
+GLuint upscaleTex = 0;
+GLuint linearSampler = 0;
+
+FrameCapture capture;
+StagingRing staging;
+// totals over every scene upload, printed with the load stats
+size_t uploadedBytes = 0;
+double uploadMs = 0;
 
 void createPingPongBuffers(int width, int height) {
     glGenFramebuffers(2, pingpongFBO);
@@ -37,44 +122,78 @@ void createPingPongBuffers(int width, int height) {
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
-std::string loadShaderSource(const char* path) {
-    std::ifstream file(path);
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
-GLuint compileShader(GLenum type, const std::string& source) {
-    GLuint shader = glCreateShader(type);
-    const char* src = source.c_str();
-    glShaderSource(shader, 1, &src, nullptr);
-    glCompileShader(shader);
-
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char log[512];
-        glGetShaderInfoLog(shader, 512, nullptr, log);
-        std::cerr << "Shader compilation failed:\n" << log << std::endl;
-    }
-    return shader;
-}
-GLuint createShaderProgram(const char* vertPath, const char* fragPath) {
-    GLuint vert = compileShader(GL_VERTEX_SHADER, loadShaderSource(vertPath));
-    GLuint frag = compileShader(GL_FRAGMENT_SHADER, loadShaderSource(fragPath));
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vert);
-    glAttachShader(program, frag);
-    glLinkProgram(program);
-
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-    return program;
+void createUpscaleTarget(int width, int height) {
+    glGenFramebuffers(1, &upscaleFBO);
+    glGenTextures(1, &upscaleTex);
+    glBindTexture(GL_TEXTURE_2D, upscaleTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, upscaleFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, upscaleTex, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Upscale FBO not complete!\n";
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // the ping-pong textures stay nearest for the trace pass, the upscale reads them through this
+    glGenSamplers(1, &linearSampler);
+    glSamplerParameteri(linearSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(linearSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(linearSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(linearSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+void releaseUpscaleTarget() {
+    if (upscaleFBO == 0) return;
+    glDeleteFramebuffers(1, &upscaleFBO);
+    glDeleteTextures(1, &upscaleTex);
+    glDeleteSamplers(1, &linearSampler);
+    upscaleFBO = upscaleTex = linearSampler = 0;
 }
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+    if (key == GLFW_KEY_C && action == GLFW_PRESS)
+        capture.toggle();
+    if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+        variant = (variant + 1) % NUM_VARIANTS;
+        variantChanged = true;
+    }
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+        propRequest = 1;
+    if (key == GLFW_KEY_O && action == GLFW_PRESS)
+        propRequest = -1;
+}
+// Starts the shader builds; they finish in finishShaders() after the scene is loaded.
+bool initGL(const GLADloadfunc load, const Options& options) {
+    programCache.init(load, options.shaderCache);
+    staging.init(load);
+    if (!traceVariants.load("shaders/fullscreen.vert", "shaders/fullscreen.frag", programCache)) {
+        std::cerr << "Failed to load shaders/fullscreen.frag\n";
+        return false;
+    }
+    ShaderKey key;
+    key.quantizedBVH = options.nodeLayout == NodeLayout::Quantized;
+    key.triangleData = options.triangleLayout == TriangleLayout::Precomputed;
+    key.instances = options.instancing;
+    key.stackless = options.traversal == TraversalMode::Stackless && options.nodeLayout == NodeLayout::Float;
+    key.spheres = options.particles > 0;
+    key.paged = !options.paged.empty() && options.nodeLayout == NodeLayout::Float && options.traversal == TraversalMode::Stack;
+    traceVariants.prefetch(key);
+    displayPending = programCache.begin("display", loadShaderSource("shaders/fullscreen.vert"), loadShaderSource("shaders/display.frag"));
+    upscalePending = programCache.begin("upscale", loadShaderSource("shaders/fullscreen.vert"), loadShaderSource("shaders/upscale.frag"));
+    if (options.refit == RefitMode::Compute) refitProgram = createComputeProgram("shaders/refit.comp");
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    return true;
+}
+void finishShaders() {
+    displayShader = programCache.finish(displayPending);
+    upscaleShader = programCache.finish(upscalePending);
+    shaderProgram = traceVariants.get(ShaderKey());
 }
-bool setup() {
+bool setup(const Options& options) {
     if (!glfwInit()) return false;
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -97,24 +216,193 @@ bool setup() {
         return false;
     }
 
-    shaderProgram = createShaderProgram("shaders/fullscreen.vert", "shaders/fullscreen.frag");
-    displayShader = createShaderProgram("shaders/fullscreen.vert", "shaders/display.frag");
-
     //glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
 
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-
-    return true;
+    return initGL(glfwGetProcAddress, options);
+}
+bool setupHeadless(const Options& options) {
+#ifdef HAS_EGL
+    if (!headlessContext.create(4, 3)) return false;
+    if (!headlessContext.loadGL()) return false;
+    return initGL(HeadlessContext::getProcAddress, options);
+#else
+    std::cerr << "Headless mode needs EGL, which was not found at build time\n";
+    return false;
+#endif
 }
 bool shouldClose() {
     return glfwWindowShouldClose(window);
 }
 void shutdown() {
-    glDeleteProgram(shaderProgram);
+    capture.finish();
+    staging.release();
+    traceVariants.release();
+    glDeleteProgram(displayShader);
+    glDeleteProgram(upscaleShader);
+    glDeleteProgram(refitProgram);
     glDeleteVertexArrays(1, &vao);
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (window != nullptr) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+#ifdef HAS_EGL
+    headlessContext.destroy();
+#endif
+}
+bool parseArguments(const int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = std::stoi(argv[++i]);
+        } else if (arg == "--size" && hasValue) {
+            const std::string size = argv[++i];
+            const size_t x = size.find('x');
+            if (x == std::string::npos) return false;
+            options.width = std::stoi(size.substr(0, x));
+            options.height = std::stoi(size.substr(x + 1));
+        } else if (arg == "--out" && hasValue) {
+            options.output = argv[++i];
+        } else if (arg == "--model" && hasValue) {
+            options.model = argv[++i];
+        } else if (arg == "--scene" && hasValue) {
+            options.scene = argv[++i];
+        } else if (arg == "--camera" && hasValue) {
+            glm::vec3& p = options.cameraPos;
+            glm::vec3& f = options.cameraForward;
+            if (std::sscanf(argv[++i], "%f,%f,%f,%f,%f,%f", &p.x, &p.y, &p.z, &f.x, &f.y, &f.z) != 6) return false;
+            options.hasCamera = true;
+        } else if (arg == "--capture" && hasValue) {
+            options.capture = argv[++i];
+        } else if (arg == "--capture-fps" && hasValue) {
+            options.captureFps = std::stoi(argv[++i]);
+        } else if (arg == "--record" && hasValue) {
+            options.record = argv[++i];
+        } else if (arg == "--replay" && hasValue) {
+            options.replay = argv[++i];
+            if (options.report.empty()) options.report = "replay_report.csv";
+        } else if (arg == "--report" && hasValue) {
+            options.report = argv[++i];
+        } else if (arg == "--variant" && hasValue) {
+            options.variant = std::stoi(argv[++i]);
+            if (options.variant < 0 || options.variant >= NUM_VARIANTS) return false;
+        } else if (arg == "--variant-bench") {
+            options.variantBench = true;
+        } else if (arg == "--shader-cache" && hasValue) {
+            options.shaderCache = argv[++i];
+        } else if (arg == "--no-shader-cache") {
+            options.shaderCache.clear();
+        } else if (arg == "--geometry" && hasValue) {
+            const std::string mode = argv[++i];
+            if (mode == "retained") options.geometry = GeometryMode::Retained;
+            else if (mode == "moved") options.geometry = GeometryMode::Moved;
+            else if (mode == "streaming") options.geometry = GeometryMode::Streaming;
+            else return false;
+        } else if (arg == "--bvh" && hasValue) {
+            const std::string layout = argv[++i];
+            if (layout == "float") options.nodeLayout = NodeLayout::Float;
+            else if (layout == "quantized") options.nodeLayout = NodeLayout::Quantized;
+            else return false;
+        } else if (arg == "--traversal" && hasValue) {
+            const std::string mode = argv[++i];
+            if (mode == "stack") options.traversal = TraversalMode::Stack;
+            else if (mode == "stackless") options.traversal = TraversalMode::Stackless;
+            else return false;
+        } else if (arg == "--triangles" && hasValue) {
+            const std::string layout = argv[++i];
+            if (layout == "indexed") options.triangleLayout = TriangleLayout::Indexed;
+            else if (layout == "precomputed") options.triangleLayout = TriangleLayout::Precomputed;
+            else return false;
+        } else if (arg == "--node-order" && hasValue) {
+            const std::string order = argv[++i];
+            if (order == "build") options.build.order = NodeOrder::Build;
+            else if (order == "depth-first") options.build.order = NodeOrder::DepthFirst;
+            else if (order == "veb") options.build.order = NodeOrder::VanEmdeBoas;
+            else return false;
+        } else if (arg == "--builder" && hasValue) {
+            const std::string builder = argv[++i];
+            if (builder == "binned") options.build.builder = Builder::Binned;
+            else if (builder == "sbvh") options.build.builder = Builder::SpatialSplit;
+            else if (builder == "ploc") options.build.builder = Builder::PLOC;
+            else return false;
+        } else if (arg == "--max-depth" && hasValue) {
+            options.build.maxDepth = std::stoi(argv[++i]);
+        } else if (arg == "--sbvh-budget" && hasValue) {
+            options.build.duplicationBudget = std::stof(argv[++i]);
+        } else if (arg == "--animate") {
+            options.animate = true;
+        } else if (arg == "--refit" && hasValue) {
+            const std::string mode = argv[++i];
+            if (mode == "cpu") options.refit = RefitMode::Host;
+            else if (mode == "gpu") options.refit = RefitMode::Compute;
+            else return false;
+        } else if (arg == "--rebuild-ratio" && hasValue) {
+            options.rebuildRatio = std::stof(argv[++i]);
+        } else if (arg == "--instancing") {
+            options.instancing = true;
+        } else if (arg == "--objects" && hasValue) {
+            options.objects = std::stoi(argv[++i]);
+            options.instancing = true;
+        } else if (arg == "--particles" && hasValue) {
+            options.particles = std::stoi(argv[++i]);
+        } else if (arg == "--lod" && hasValue) {
+            options.build.lodLevels = std::stoi(argv[++i]);
+        } else if (arg == "--lod-ratio" && hasValue) {
+            options.build.lodRatio = std::stof(argv[++i]);
+        } else if (arg == "--lod-error" && hasValue) {
+            options.lodPixelError = std::stof(argv[++i]);
+        } else if (arg == "--target-ms" && hasValue) {
+            options.targetMs = std::stod(argv[++i]);
+        } else if (arg == "--min-scale" && hasValue) {
+            options.minScale = std::stof(argv[++i]);
+        } else if (arg == "--paged" && hasValue) {
+            options.paged = argv[++i];
+        } else if (arg == "--page-budget" && hasValue) {
+            options.pageBudget = std::stoi(argv[++i]);
+        } else if (arg == "--early-split" && hasValue) {
+            options.build.earlySplitBudget = std::stof(argv[++i]);
+        } else if (arg == "--early-split-threshold" && hasValue) {
+            options.build.earlySplitThreshold = std::stof(argv[++i]);
+        } else if (arg == "--cleanup") {
+            options.build.cleanup = true;
+        } else if (arg == "--weld-tolerance" && hasValue) {
+            options.build.weldTolerance = std::stof(argv[++i]);
+            options.build.cleanup = true;
+        } else if (arg == "--optimize-ms" && hasValue) {
+            options.build.optimizeMs = std::stod(argv[++i]);
+        } else if (arg == "--traversal-bench" && hasValue) {
+            options.traversalBench = std::stoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = glm::uint(std::stoul(argv[++i]));
+            options.hasSeed = true;
+        } else {
+            return false;
+        }
+    }
+    if (options.animate && options.build.lodLevels > 0) {
+        std::cout << "--animate can't deform simplified levels, building without --lod" << std::endl;
+        options.build.lodLevels = 0;
+    }
+    if (options.animate && !options.paged.empty()) {
+        std::cout << "--animate can't deform paged models, keeping them resident" << std::endl;
+        options.paged.clear();
+    }
+    if (options.animate && options.geometry == GeometryMode::Streaming) {
+        std::cout << "--animate needs host geometry, using --geometry moved" << std::endl;
+        options.geometry = GeometryMode::Moved;
+    }
+    return options.frames > 0 && options.width > 0 && options.height > 0;
+}
+
+bool parseOptions(const int argc, char** argv, Options& options) {
+    // std::stoi and the like throw on values that aren't numbers, which get the usage line like any other bad argument
+    try {
+        return parseArguments(argc, argv, options);
+    } catch (const std::exception&) {
+        return false;
+    }
 }
 
 class Timer {
@@ -155,84 +443,605 @@ public:
     }
 };
 
-int main() {
-    if (!setup()) return -1;
+// --particles: small analytic spheres scattered around the dragons, the same ones every run
+void addParticles(const Options& options, std::vector<SphereGroup>& spheres) {
+    if (options.particles <= 0) return;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> x(-400, 400), y(-360, 0), z(-300, 200), radius(0.3f, 1.5f);
+    SphereGroup particles{{}, glm::vec3(0.9, 0.6, 0.3), 0.3, 0};
+    particles.spheres.reserve(options.particles);
+    for (int i = 0; i < options.particles; ++i) particles.spheres.emplace_back(x(random), y(random), z(random), radius(random));
+    spheres.push_back(std::move(particles));
+}
+
+bool sceneInstances(const Options& options, std::vector<ModelInstance>& instances, std::vector<SphereGroup>& spheres) {
+    addParticles(options, spheres);
+    if (!options.scene.empty()) return readSceneFile(options.scene, instances, spheres);
 
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
+    const std::string& dragon = options.model;
+    //instances.push_back({dragon, glm::vec3(-220, -317, 0), glm::vec3(25, 25, 25), glm::vec3(0.8, 0.6, 0.1), 0.6, 0});
+    //instances.push_back({dragon, glm::vec3(-170, -300, 0), glm::vec3(50, 50, 50), glm::vec3(0.1, 0.8, 0.1), 0.6, 0});
+    instances.push_back({dragon, glm::vec3(-100, -285, 0), glm::vec3(75, 75, 75), glm::vec3(0.1, 0.1, 0.8), 0.6, 0});
+    instances.push_back({dragon, glm::vec3(0, -265, 0), glm::vec3(100, 100, 100), glm::vec3(0.8, 0.1, 0.1), 0.6, 0});
+    //instances.push_back({"sponza.txt", glm::vec3(0, 0, 0), glm::vec3(800, 800, 800), glm::vec3(0.9, 0.9, 0.9), 0, 0});
+    return true;
+}
+
+// sphere sets are built here, before the models start streaming in
+void addSphereGroups(Scene& scene, const std::vector<SphereGroup>& groups, const BuildOptions& options) {
+    for (const SphereGroup& group : groups) {
+        scene.addSpheres(SphereSet(group.spheres, options), group.color, group.smoothness, group.emission);
+    }
+}
+
+size_t uploadScene(Scene& scene) {
+    const auto start = std::chrono::steady_clock::now();
+    const size_t bytes = scene.set_ssbo(staging);
+    uploadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    uploadedBytes += bytes;
+    return bytes;
+}
+// peak resident set size in MB where the OS reports it, otherwise -1
+double peakResidentMB() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) return std::stod(line.substr(6)) / 1024.0;
+    }
+    return -1;
+}
+void printMemory(const Scene& scene) {
+    constexpr const char* modes[] = {"retained", "moved", "streaming"};
+    std::cout << "Memory (MB, " << modes[int(scene.getGeometryMode())] << "): host " << double(scene.getHostBytes()) / (1 << 20)
+              << ", gpu " << double(scene.getGpuBytes()) / (1 << 20);
+    const double peak = peakResidentMB();
+    if (peak >= 0) std::cout << ", peak resident " << peak;
+    std::cout << std::endl;
+}
+void printStats(Scene& scene, const float duration) {
+    if (scene.getNumBVHNodes() == 0) return;
+    std::cout << std::endl;
+    std::cout << "Time (ms): " << duration*1000.0f << std::endl;
+    std::cout << "Uploaded (MB): " << double(uploadedBytes) / (1 << 20) << " in " << uploadMs << " ms" << std::endl;
+    printMemory(scene);
+    std::cout << "Triangles: " << scene.getNumTris() << std::endl;
+    if (scene.getNumSpheres() > 0) {
+        std::cout << "Spheres: " << scene.getNumSpheres() << " in " << scene.getNumSphereSets() << " sets, "
+                  << double(scene.getNumSpheres()) * sizeof(glm::vec4) / (1 << 20) << " MB" << std::endl;
+    }
+    size_t lodSelected = 0, lodFull = 0;
+    scene.getLodTriangles(lodSelected, lodFull);
+    if (lodFull > 0) std::cout << "LOD Triangles: " << lodSelected << " selected of " << lodFull << " at full detail" << std::endl;
+    if (scene.isPaged()) {
+        const PagingStats& paging = scene.getPagingStats();
+        std::cout << "Paged Triangles: " << paging.triangles << " in " << paging.pages << " pages, "
+                  << double(paging.fileBytes) / (1 << 20) << " MB on disk, " << paging.slots << " slots of "
+                  << double(PagedGeometry::SLOT_BYTES) / (1 << 20) << " MB" << std::endl;
+    }
+    std::cout << "Node Count: " << scene.getNumBVHNodes() << std::endl;
+    std::cout << "Node Memory (MB, " << (scene.getNodeLayout() == NodeLayout::Quantized ? "quantized" : "float") << "): "
+              << double(scene.getNodeBytes()) / (1 << 20) << std::endl;
+    std::cout << "Triangle Memory (MB, " << (scene.getTriangleLayout() == TriangleLayout::Precomputed ? "precomputed" : "indexed") << "): "
+              << double(scene.getTriangleBytes()) / (1 << 20) << std::endl;
+    if (!scene.hasHostGeometry()) return;
+
+    int leafNodes = 0, depth = 0, triPerLeaf = 0;
+    int minTriPerLeaf = 10000, maxTriPerLeaf = 0;
+    int minDepth = 10000, maxDepth = 0;
+    scene.get_BVH_stats(0, leafNodes, depth, minDepth, maxDepth, triPerLeaf, minTriPerLeaf, maxTriPerLeaf, 1);
+    std::cout << "Leaf Count: " << leafNodes << std::endl;
+    // paged models keep only links on the host, their leaves are counted with the pages
+    if (leafNodes == 0) return;
+    std::cout << "Leaf Depth: " << std::endl;
+    std::cout << "  -  Min: " << minDepth << std::endl;
+    std::cout << "  -  Max: " << maxDepth << std::endl;
+    std::cout << "  -  Mean: " << float(depth)/float(leafNodes) << std::endl;
+    std::cout << "Leaf Tris: " << std::endl;
+    std::cout << "  -  Min: " << minTriPerLeaf << std::endl;
+    std::cout << "  -  Max: " << maxTriPerLeaf << std::endl;
+    std::cout << "  -  Mean: " << float(triPerLeaf)/float(leafNodes) << std::endl;
+}
+
+constexpr int DEFAULT_STACK_SIZE = 33;
+
+ShaderKey variantKey(const Scene& scene, const int index) {
+    ShaderKey key;
+    key.quantizedBVH = scene.getNodeLayout() == NodeLayout::Quantized;
+    key.triangleData = scene.getTriangleLayout() == TriangleLayout::Precomputed;
+    key.instances = scene.getInstancing();
+    key.stackless = scene.getTraversalMode() == TraversalMode::Stackless;
+    key.spheres = scene.getNumSphereSets() > 0;
+    key.paged = scene.isPaged();
+    // the default stack holds trees of up to 33 levels, deeper ones get a variant sized to them
+    if (!key.stackless && scene.getTreeDepth() > DEFAULT_STACK_SIZE) key.stackSize = scene.getTreeDepth();
+    if (index == 0) return key;
+    key.specialized = true;
+    key.bounceLim = scene.getBounceLim();
+    key.samples = scene.getSamples();
+    key.aa = scene.getAA();
+    key.numModels = scene.getNumModels();
+    key.debugMode = index == 2 ? 1 : 0;
+    return key;
+}
+
+// Switches the trace program, compiling the permutation on first use.
+void selectVariant(Scene& scene, FrameProfiler& profiler, const int index) {
+    const ShaderKey key = variantKey(scene, index);
+    variant = index;
+    shaderProgram = traceVariants.get(key);
+    scene.resetAccumulation();
+    profiler.setLabel(key.name());
+    std::cout << "Shader variant: " << key.name() << std::endl;
+}
+
+// Accumulates one frame into pingpongFBO[ping], blending with pingpongTex[pong].
+// Expects shaderProgram in use with the frame's uniforms already set.
+void tracePass(const int ping, const int pong, const int width, const int height) {
+    glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[ping]);
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, pingpongTex[pong]);
+    glUniform1i(glGetUniformLocation(shaderProgram, "uPrevFrame"), 0);
+
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+// Re-specifies the ping-pong textures at the scaler's trace size. What they
+// held was traced at the old size, so they are cleared and accumulation restarts.
+void applyTraceScale(Scene& scene, const int width, const int height, int& traceWidth, int& traceHeight) {
+    scaler.traceSize(width, height, traceWidth, traceHeight);
+    for (int i = 0; i < 2; ++i) {
+        glBindTexture(GL_TEXTURE_2D, pingpongTex[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, traceWidth, traceHeight, 0, GL_RGBA, GL_FLOAT, nullptr);
+        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
+        glViewport(0, 0, traceWidth, traceHeight);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    scene.setResolution(traceWidth, traceHeight);
+}
+
+// Hands the scaler the newest GPU time before the next frame is traced and resizes on a change.
+void updateScale(Scene& scene, const FrameProfiler& profiler, const int width, const int height, int& traceWidth, int& traceHeight) {
+    if (!scaler.isEnabled()) return;
+    double ms = 0;
+    const int sample = profiler.latestGpu(ms);
+    if (!scaler.update(profiler.frames(), sample, ms)) return;
+    applyTraceScale(scene, width, height, traceWidth, traceHeight);
+    std::cout << "Resolution scale " << scaler.getScale() << ": tracing " << traceWidth << "x" << traceHeight << " after "
+              << scaler.getAverageMs() << " ms frames" << std::endl;
+}
+
+// Brings a frame traced smaller up to the output size in upscaleFBO and
+// returns whether it did; frames traced at full size are used as they are.
+bool upscalePass(const int ping, const int width, const int height, const int traceWidth, const int traceHeight) {
+    if (traceWidth == width && traceHeight == height) return false;
+    glBindFramebuffer(GL_FRAMEBUFFER, upscaleFBO);
+    glViewport(0, 0, width, height);
+    glUseProgram(upscaleShader);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, pingpongTex[ping]);
+    glBindSampler(0, linearSampler);
+    glUniform1i(glGetUniformLocation(upscaleShader, "screenTex"), 0);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindSampler(0, 0);
+    return true;
+}
+
+void printScale(const int width, const int height) {
+    if (!scaler.isEnabled()) return;
+    int traceWidth, traceHeight;
+    scaler.traceSize(width, height, traceWidth, traceHeight);
+    std::cout << "Resolution scale: " << scaler.getScale() << " (" << traceWidth << "x" << traceHeight << " of " << width << "x" << height
+              << ") after " << scaler.getChanges() << " changes" << std::endl;
+}
+
+// Sets this frame's camera and uniforms, from the replayed path when there is one.
+void updateFrame(Scene& scene, const CameraPath& replay, const int frame, const float dt) {
+    glUseProgram(shaderProgram);
+    if (replay.size() > 0) {
+        scene.updateFrame(shaderProgram, replay[frame].position, replay[frame].forward);
+    } else if (window != nullptr) {
+        scene.updateFrame(shaderProgram, *window, dt);
+    } else {
+        scene.updateFrame(shaderProgram);
+    }
+}
+
+bool loadReplay(const Options& options, Scene& scene, CameraPath& replay) {
+    if (options.replay.empty()) {
+        if (options.hasSeed) scene.setSeed(options.seed);
+        return true;
+    }
+    if (!replay.load(options.replay)) return false;
+    scene.setSeed(options.hasSeed ? options.seed : 1);
+    return true;
+}
+
+// Only the new or removed ranges go to the GPU, so this stays fast however large the scene already is.
+void updateProps(Scene& scene, FrameProfiler& profiler, std::vector<int>& props) {
+    static BaseModel prop("sphere.txt");
+    const auto start = std::chrono::steady_clock::now();
+    if (propRequest > 0) {
+        props.push_back(scene.getNumModels());
+        scene.addModel(prop, scene.getCameraPos() + scene.getCameraForward() * 100.0f, glm::vec3(10), glm::vec3(0.8, 0.2, 0.2), 0.5, 0);
+    } else if (!props.empty()) {
+        scene.removeModel(props.back());
+        props.pop_back();
+    }
+    propRequest = 0;
+    const size_t bytes = uploadScene(scene);
+    std::cout << "Props: " << props.size() << "  -  uploaded " << bytes / 1024.0 << " KB in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+    scene.resetAccumulation();
+    selectVariant(scene, profiler, variant);
+}
+// Sways every model with a travelling wave, a stand-in for skinned or keyframed
+// meshes. rest holds each model's vertices as loaded and grows as models arrive.
+void animateScene(Scene& scene, std::vector<std::vector<glm::vec3>>& rest, const float time) {
+    rest.resize(scene.getNumModels());
+    std::vector<glm::vec3> positions;
+    for (int i = 0; i < scene.getNumModels(); ++i) {
+        if (rest[i].empty()) rest[i] = scene.getModelVertices(i);
+        positions = rest[i];
+        for (glm::vec3& p : positions) {
+            // models are centered in [-1, 1], the tail moves most
+            const float weight = 0.15f * (p.x + 1);
+            p.y += weight * std::sin(3 * p.x + 2 * time);
+            p.z += weight * std::cos(2 * p.x + 1.5f * time);
+        }
+        scene.updateModelVertices(i, positions);
+    }
+    scene.resetAccumulation();
+}
+// --objects: copies of one sphere that each follow their own orbit around the
+// dragons. They share the sphere's BVH, so moving them only rebuilds the
+// top-level BVH and uploads the instance transforms. Returns the first instance.
+int addObjects(Scene& scene, const int count, const BuildOptions& build) {
+    if (count <= 0) return -1;
+    scene.addModel(BaseModel("sphere.txt", build), glm::vec3(0), glm::vec3(6), glm::vec3(0.9, 0.7, 0.2), 0.8, 0);
+    const int model = scene.getNumModels() - 1;
+    const int first = scene.getNumInstances() - 1;
+    for (int i = 1; i < count; ++i) scene.addInstance(model, glm::mat4(1));
+    return first;
+}
+void moveObjects(Scene& scene, const int first, const int count, const float time) {
+    for (int i = 0; i < count; ++i) {
+        const int ring = i % 8;
+        const float speed = (ring % 2 == 0 ? 0.3f : -0.25f) * (1 + 0.1f * float(ring));
+        const float angle = float(i / 8) * 6.2831853f / float((count + 7) / 8) + time * speed;
+        const float radius = 140.0f + 20.0f * float(ring);
+        const glm::vec3 position(-50 + radius * std::cos(angle), -300 + 25.0f * float(ring), radius * std::sin(angle));
+        scene.setInstanceTransform(first + i, glm::translate(glm::mat4(1), position));
+    }
+}
+void printAnimation(const Scene& scene) {
+    const RefitStats& stats = scene.getRefitStats();
+    if (stats.refits == 0) return;
+    std::cout << "Animation: " << stats.refits << " refits, " << stats.refitMs / stats.refits << " ms each, "
+              << stats.rebuilds << " rebuilds, " << (stats.rebuilds > 0 ? stats.rebuildMs / stats.rebuilds : 0) << " ms each";
+    if (stats.rebuildsSkipped > 0) std::cout << " (" << stats.rebuildsSkipped << " skipped, tree outgrew its range)";
+    std::cout << std::endl;
+}
+void printPaging(const Scene& scene) {
+    if (!scene.isPaged()) return;
+    const PagingStats& stats = scene.getPagingStats();
+    std::cout << "Paging: " << stats.loads << " loads (" << double(stats.loadedBytes) / (1 << 20) << " MB), " << stats.evictions
+              << " evictions, " << stats.misses << " page misses read back, " << stats.loadMs << " ms in updates" << std::endl;
+    if (stats.grows > 0) {
+        std::cout << "  -  the budget was too small for the view, the pool grew " << stats.grows << " times to " << stats.slots << " slots"
+                  << std::endl;
+    }
+}
+// Paged models start with nothing resident. Traces the first frame again until
+// it misses no page, or no more fit, so the timed frames see the whole scene;
+// the seed doesn't advance, so the result matches an unpaged render.
+void warmPages(Scene& scene, const int ping, const int pong, const int width, const int height) {
+    constexpr int MAX_PASSES = 256;
+    const auto start = std::chrono::steady_clock::now();
+    int passes = 0, loaded = 0;
+    while (passes < MAX_PASSES) {
+        glUseProgram(shaderProgram);
+        scene.setUniforms(shaderProgram);
+        tracePass(ping, pong, width, height);
+        passes++;
+        const int pages = scene.updatePages(staging, true);
+        if (pages == 0) break;
+        loaded += pages;
+    }
+    scene.resetAccumulation();
+    std::cout << "Paging warm-up: " << loaded << " pages in " << passes << " passes, "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+}
+void finishProfiling(const Options& options, FrameProfiler& profiler) {
+    profiler.resolve();
+    if (profiler.frames() > 0) {
+        std::cout << std::endl;
+        profiler.printSummary(options.replay.empty() ? "Frame Times" : "Replay " + options.replay);
+        if (!options.report.empty()) (void)profiler.writeReport(options.report);
+    }
+    profiler.release();
+}
+
+// Renders a fixed number of accumulation frames offscreen and writes the result.
+int runHeadless(const Options& options) {
+    const auto startupBegin = std::chrono::steady_clock::now();
+    if (!setupHeadless(options)) return -1;
+
+    const int width = options.width, height = options.height;
     Scene scene(width, height, 1,3, 4);
+    scene.setGeometryMode(options.geometry);
+    scene.setNodeLayout(options.nodeLayout);
+    scene.setTraversalMode(options.traversal);
+    scene.setTriangleLayout(options.triangleLayout);
+    scene.setRefitMode(options.refit, refitProgram);
+    scene.setRebuildRatio(options.rebuildRatio);
+    scene.setInstancing(options.instancing);
+    scene.setLodPixelError(options.lodPixelError);
+    if (!options.paged.empty()) scene.setPaging(options.paged, size_t(options.pageBudget) << 20);
+    const int firstObject = addObjects(scene, options.objects, options.build);
+    if (options.hasCamera) scene.setCamera(options.cameraPos, options.cameraForward);
+
+    CameraPath replay, recording;
+    if (!loadReplay(options, scene, replay)) {
+        shutdown();
+        return -1;
+    }
+    // --variant-bench runs the whole sequence once with the generic and once with the specialized shader
+    const int framesPerVariant = replay.size() > 0 ? replay.size() : options.frames;
+    const int frames = options.variantBench ? 2 * framesPerVariant : framesPerVariant;
+
+    // headless renders need the complete scene, so wait for every model,
+    // uploading each one while the builders are still busy with the next
+    ModelLoader loader;
+    const auto loadStart = std::chrono::steady_clock::now();
+    std::vector<SphereGroup> sphereGroups;
+    std::vector<ModelInstance> instances;
+    if (!sceneInstances(options, instances, sphereGroups)) {
+        shutdown();
+        return -1;
+    }
+    addSphereGroups(scene, sphereGroups, options.build);
+    loader.begin(instances, options.build);
+    while (!loader.finished()) {
+        if (loader.poll(scene, true) > 0) uploadScene(scene);
+    }
+    const float duration = std::chrono::duration<float>(std::chrono::steady_clock::now() - loadStart).count();
 
-    Timer t;
+    scene.updateLods();
+    uploadScene(scene);
+    finishShaders();
 
-    BaseModel dragon("dragon800K.txt");
+    createPingPongBuffers(width, height);
+    int ping = 0; int pong = 1;
+    scaler.setTarget(options.targetMs, options.minScale);
+    if (scaler.isEnabled()) createUpscaleTarget(width, height);
+    int traceWidth = width, traceHeight = height;
+
+    printStats(scene, duration);
+    if (options.traversalBench > 0) {
+        if (scene.hasHostGeometry()) scene.benchmarkTraversal(options.traversalBench);
+        else std::cout << "--traversal-bench needs --geometry retained or moved" << std::endl;
+    }
+    std::cout << "Startup (ms): " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count() << std::endl;
+
+    if (!options.capture.empty()) capture.start(options.capture, width, height, options.captureFps);
 
-    //scene.addModel(dragon, glm::vec3(-220, -317, 0), glm::vec3(25, 25, 25), glm::vec3(0.8, 0.6, 0.1), 0.6, 0);
-    //scene.addModel(dragon, glm::vec3(-170, -300, 0), glm::vec3(50, 50, 50), glm::vec3(0.1, 0.8, 0.1), 0.6, 0);
-    scene.addModel(dragon, glm::vec3(-100, -285, 0), glm::vec3(75, 75, 75), glm::vec3(0.1, 0.1, 0.8), 0.6, 0);
-    scene.addModel(dragon, glm::vec3(0, -265, 0), glm::vec3(100, 100, 100), glm::vec3(0.8, 0.1, 0.1), 0.6, 0);
-    //scene.addModel("sponza.txt", glm::vec3(0, 0, 0), glm::vec3(800, 800, 800), glm::vec3(0.9, 0.9, 0.9), 0, 0);
+    FrameProfiler profiler;
+    selectVariant(scene, profiler, options.variantBench ? 0 : options.variant);
+    if (scene.isPaged()) warmPages(scene, ping, pong, width, height);
 
-    float duration = t.reset();
+    std::vector<std::vector<glm::vec3>> rest;
+    double objectMs = 0;
+    // the last full size frame, the ping-pong target or the upscaled one
+    GLuint outputFBO = pingpongFBO[pong];
+    glFinish();
+    const auto renderStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        if (options.variantBench && frame == framesPerVariant) selectVariant(scene, profiler, 1);
+        if (options.animate) {
+            animateScene(scene, rest, float(frame) / 30.0f);
+            uploadScene(scene);
+        }
+        if (options.objects > 0) {
+            const auto objectStart = std::chrono::steady_clock::now();
+            moveObjects(scene, firstObject, options.objects, float(frame) / 30.0f);
+            uploadScene(scene);
+            scene.resetAccumulation();
+            objectMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - objectStart).count();
+        }
+        updateScale(scene, profiler, width, height, traceWidth, traceHeight);
+        updateFrame(scene, replay, frame % framesPerVariant, 0);
+        if (scene.updateLods()) uploadScene(scene);
+        if (!options.record.empty()) recording.record(scene.getCameraPos(), scene.getCameraForward());
+
+        profiler.begin();
+        tracePass(ping, pong, traceWidth, traceHeight);
+        profiler.end();
+        scene.updatePages(staging);
+
+        outputFBO = upscalePass(ping, width, height, traceWidth, traceHeight) ? upscaleFBO : pingpongFBO[ping];
+        capture.capture(outputFBO);
+
+        std::swap(ping, pong);
+    }
+    glFinish();
+    const double renderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+
+    std::vector<float> pixels(size_t(width) * height * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, outputFBO);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_FLOAT, pixels.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::cout << std::endl;
+    std::cout << "Frames: " << frames << std::endl;
+    std::cout << "Render Time (ms): " << renderMs << std::endl;
+    std::cout << "  -  Per Frame: " << renderMs / frames << std::endl;
+    std::cout << "  -  MPix/s: " << double(width) * height * frames / (renderMs * 1000.0) << std::endl;
+    printAnimation(scene);
+    printPaging(scene);
+    printScale(width, height);
+    if (options.objects > 0) {
+        const InstanceStats& stats = scene.getInstanceStats();
+        std::cout << "Objects: " << options.objects << ", CPU update " << objectMs / frames << " ms per frame (top-level build and upload "
+                  << stats.buildMs / stats.builds << " ms), " << double(stats.uploadedBytes) / stats.builds / 1024.0 << " KB per frame" << std::endl;
+    }
+
+    finishProfiling(options, profiler);
+    if (!options.record.empty()) (void)recording.save(options.record);
+
+    const bool written = writeImage(options.output, width, height, pixels.data());
+    if (written) std::cout << "Wrote " << options.output << std::endl;
+
+    glDeleteFramebuffers(2, pingpongFBO);
+    glDeleteTextures(2, pingpongTex);
+    releaseUpscaleTarget();
+    scene.releaseBuffers();
+    shutdown();
+    return written ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--model file | --scene file] [--camera px,py,pz,fx,fy,fz]"
+                  << " [--record path.txt | --replay path.txt [--report times.csv]] [--seed N] [--shader-cache dir | --no-shader-cache]"
+                  << " [--geometry streaming|moved|retained] [--bvh float|quantized] [--traversal stack|stackless] [--triangles indexed|precomputed]"
+                  << " [--node-order build|depth-first|veb] [--builder binned|sbvh|ploc [--sbvh-budget 0.25]] [--max-depth N] [--early-split 0.25 [--early-split-threshold 0.01]] [--optimize-ms N] [--cleanup [--weld-tolerance 1e-6]]"
+                  << " [--lod N [--lod-ratio 0.25] [--lod-error pixels]] [--paged pages.bin [--page-budget MB]] [--target-ms N [--min-scale 0.25]]"
+                  << " [--animate [--refit cpu|gpu] [--rebuild-ratio 1.5]] [--instancing] [--objects N] [--particles N]"
+                  << " [--variant 0|1|2] [--capture frame_%05d.png|.ppm|.pfm|out.y4m [--capture-fps N]]"
+                  << " [--headless [--frames N] [--size WxH] [--variant-bench] [--traversal-bench rays] [--out image.png|.ppm|.pfm]]\n";
+        return -1;
+    }
+    if (options.headless) return runHeadless(options);
+
+    const auto startupBegin = std::chrono::steady_clock::now();
+    if (!setup(options)) return -1;
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    Scene scene(width, height, 1,3, 4);
+    scene.setGeometryMode(options.geometry);
+    scene.setNodeLayout(options.nodeLayout);
+    scene.setTraversalMode(options.traversal);
+    scene.setTriangleLayout(options.triangleLayout);
+    scene.setRefitMode(options.refit, refitProgram);
+    scene.setRebuildRatio(options.rebuildRatio);
+    scene.setInstancing(options.instancing);
+    scene.setLodPixelError(options.lodPixelError);
+    if (!options.paged.empty()) scene.setPaging(options.paged, size_t(options.pageBudget) << 20);
+    const int firstObject = addObjects(scene, options.objects, options.build);
+    if (options.hasCamera) scene.setCamera(options.cameraPos, options.cameraForward);
+
+    CameraPath replay, recording;
+    if (!loadReplay(options, scene, replay)) {
+        shutdown();
+        return -1;
+    }
+
+    // models stream in while the loop runs, each one uploaded as soon as its BVH is built
+    ModelLoader loader;
+    const auto loadStart = std::chrono::steady_clock::now();
+    std::vector<SphereGroup> sphereGroups;
+    std::vector<ModelInstance> instances;
+    if (!sceneInstances(options, instances, sphereGroups)) {
+        shutdown();
+        return -1;
+    }
+    addSphereGroups(scene, sphereGroups, options.build);
+    loader.begin(instances, options.build);
 
     //scene.displayBVH();
 
-    scene.set_ssbo();
+    uploadScene(scene);
+    finishShaders();
 
     createPingPongBuffers(width, height);
     int ping = 0; int pong = 1;
+    scaler.setTarget(options.targetMs, options.minScale);
+    if (scaler.isEnabled()) createUpscaleTarget(width, height);
+    int traceWidth = width, traceHeight = height;
+    std::cout << "Startup (ms): " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count() << std::endl;
 
-    if (true) {
-        int leafNodes = 0, depth = 0, triPerLeaf = 0;
-        int minTriPerLeaf = 10000, maxTriPerLeaf = 0;
-        int minDepth = 10000, maxDepth = 0;
-        scene.get_BVH_stats(0, leafNodes, depth, minDepth, maxDepth, triPerLeaf, minTriPerLeaf, maxTriPerLeaf, 1);
-        std::cout << std::endl;
-        std::cout << "Time (ms): " << duration*1000.0f << std::endl;
-        std::cout << "Triangles: " << scene.getNumTris() << std::endl;
-        std::cout << "Node Count: " << scene.getNumBVHNodes() << std::endl;
-        std::cout << "Leaf Count: " << leafNodes << std::endl;
-        std::cout << "Leaf Depth: " << std::endl;
-        std::cout << "  -  Min: " << minDepth << std::endl;
-        std::cout << "  -  Max: " << maxDepth << std::endl;
-        std::cout << "  -  Mean: " << float(depth)/float(leafNodes) << std::endl;
-        std::cout << "Leaf Tris: " << std::endl;
-        std::cout << "  -  Min: " << minTriPerLeaf << std::endl;
-        std::cout << "  -  Max: " << maxTriPerLeaf << std::endl;
-        std::cout << "  -  Mean: " << float(triPerLeaf)/float(leafNodes) << std::endl;
-    }
+    if (!options.capture.empty()) capture.start(options.capture, width, height, options.captureFps);
+
+    FrameProfiler profiler;
+    selectVariant(scene, profiler, options.variant);
 
+    std::vector<int> props;
+    std::vector<std::vector<glm::vec3>> rest;
+    float animationTime = 0;
     Timer deltaTimer;
+    int frame = 0;
     while (!shouldClose()) {
         const auto dt = float(deltaTimer.reset());
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[ping]);
-        glViewport(0, 0, width, height);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glUseProgram(shaderProgram);
+        if (replay.size() > 0 && frame >= replay.size()) break;
+        if (variantChanged) {
+            variantChanged = false;
+            selectVariant(scene, profiler, variant);
+        }
+        if (!loader.finished()) {
+            if (loader.poll(scene, false) > 0) {
+                uploadScene(scene);
+                // numModels is baked into the specialized variants
+                selectVariant(scene, profiler, variant);
+            }
+            if (loader.finished()) printStats(scene, std::chrono::duration<float>(std::chrono::steady_clock::now() - loadStart).count());
+        }
 
-        scene.updateFrame(shaderProgram, *window, dt);
+        if (propRequest != 0 && loader.finished()) updateProps(scene, profiler, props);
+        // replays step it by frame like headless runs, so they animate the same every time
+        if (replay.size() > 0) animationTime = float(frame) / 30.0f;
+        else if (options.animate || options.objects > 0) animationTime += dt;
+        if (options.animate) {
+            animateScene(scene, rest, animationTime);
+            uploadScene(scene);
+        }
+        if (options.objects > 0) {
+            moveObjects(scene, firstObject, options.objects, animationTime);
+            uploadScene(scene);
+            scene.resetAccumulation();
+        }
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, pingpongTex[pong]);
-        glUniform1i(glGetUniformLocation(shaderProgram, "uPrevFrame"), 0);
+        updateScale(scene, profiler, width, height, traceWidth, traceHeight);
+        updateFrame(scene, replay, frame, dt);
+        if (scene.updateLods()) uploadScene(scene);
+        if (!options.record.empty()) recording.record(scene.getCameraPos(), scene.getCameraForward());
 
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+        profiler.begin();
+        tracePass(ping, pong, traceWidth, traceHeight);
+        profiler.end();
+        scene.updatePages(staging);
+
+        const bool upscaled = upscalePass(ping, width, height, traceWidth, traceHeight);
+        capture.capture(upscaled ? upscaleFBO : pingpongFBO[ping]);
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, width, height);
         glClear(GL_COLOR_BUFFER_BIT);
         glUseProgram(displayShader); // just draws the texture
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, pingpongTex[ping]);
+        glBindTexture(GL_TEXTURE_2D, upscaled ? upscaleTex : pingpongTex[ping]);
         glUniform1i(glGetUniformLocation(displayShader, "screenTex"), 0);
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
         // Swap ping-pong buffers
         std::swap(ping, pong);
+        frame++;
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
+    finishProfiling(options, profiler);
+    printAnimation(scene);
+    printPaging(scene);
+    printScale(width, height);
+    if (!options.record.empty()) (void)recording.save(options.record);
+    releaseUpscaleTarget();
+    scene.releaseBuffers();
     shutdown();
     return 0;
 }
-
-
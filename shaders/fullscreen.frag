@@ -13,8 +13,12 @@ layout(std430, binding = 1) buffer ssboTriangles {
 layout(std430, binding = 2) buffer ssboColors {
     vec4 colors[];
 };
-layout(std430, binding = 3) buffer ssboNormals {
-    vec4 normals[];
+// TRIANGLE_DATA 1: per triangle in leaf order (v0, n.x), (e1, n.y), (e2, n.z)
+#ifndef TRIANGLE_DATA
+#define TRIANGLE_DATA 0
+#endif
+layout(std430, binding = 3) buffer ssboTriangleData {
+    vec4 triangleData[];
 };
 layout(std430, binding = 4) buffer ssboEmission {
     float emission[];
@@ -29,7 +33,122 @@ layout(std430, binding = 7) buffer ssboModels {
     int models[];
 };
 
+// 1: nodes come from the quantized layout (QuantizedBVH.h) instead of boundingBoxMin/Max
+#ifndef QUANTIZED_BVH
+#define QUANTIZED_BVH 0
+#endif
+struct QuantizedNode {
+    uvec4 origin;   // xyz: box minimum as float bits, w: per-axis biased exponents
+    uvec4 bounds;   // child A low/high, child B low/high, 8 bits per axis
+    ivec4 children; // ref/count for A and B, count -1 for interior nodes
+};
+layout(std430, binding = 8) buffer ssboQuantizedNodes {
+    QuantizedNode quantizedNodes[];
+};
+layout(std430, binding = 9) buffer ssboQuantizedModels {
+    int quantizedModels[];
+};
+
+// STACKLESS 1: float nodes are walked through parent links (Hapala et al. 2011)
+// instead of a per-invocation stack, parentNodes[i] being -1 for model roots
+#ifndef STACKLESS
+#define STACKLESS 0
+#endif
+#if STACKLESS == 1
+layout(std430, binding = 13) buffer ssboParentNodes {
+    int parentNodes[];
+};
+#endif
+
+// SPHERES 1: sphere sets (SphereSet.h) are traced after the models, their
+// leaves indexing spheres[] instead of triangles[]
+#ifndef SPHERES
+#define SPHERES 0
+#endif
+#if SPHERES == 1
+layout(std430, binding = 14) buffer ssboSpheres {
+    vec4 spheres[];     // center, radius
+};
+layout(std430, binding = 15) buffer ssboSphereSets {
+    ivec4 sphereSets[]; // x: float root, y: quantized root, z: material
+};
+uniform int numSphereSets;
+// set while a sphere set is traversed, so the shared traversal code tests spheres at its leaves
+bool sphereLeaves = false;
+#endif
+
+// PAGED 1: models too large to stay resident (PagedGeometry.h) end in link
+// nodes, min.w = -page and max.w = 1, whose subtrees live in a pool of page
+// slots. Hits on page triangles are stored from PAGE_BASE on. Reaching a link
+// stamps the page's table entry with pageFrame, which the host reads back to
+// load what was missed.
+#ifndef PAGED
+#define PAGED 0
+#endif
+#if PAGED == 1
+const int PAGE_BASE = 1 << 30;
+const int PAGE_NODES = 4096;
+const int PAGE_TRIANGLES = 2048;
+layout(std430, binding = 16) buffer ssboPageNodes {
+    vec4 pageNodes[];       // min, max per node
+};
+layout(std430, binding = 17) buffer ssboPageTriangles {
+    vec4 pageTriangles[];   // (v0, material), (e1, 0), (e2, 0)
+};
+layout(std430, binding = 18) buffer ssboPageTable {
+    ivec2 pageTable[];      // x: slot or -1, y: last frame a ray reached the page
+};
+uniform int pageFrame;
+// links reached whose page was not resident, their geometry is missing from this frame
+int pageMisses = 0;
+#endif
+
+// INSTANCES 1: models are placed through instances found by a top-level BVH
+// (TopLevel.h) instead of every model being traced as added
+#ifndef INSTANCES
+#define INSTANCES 0
+#endif
+#if INSTANCES == 1
+struct Instance {
+    vec4 worldToModel[3];
+    ivec4 info;     // x: float root, y: quantized root
+};
+layout(std430, binding = 11) buffer ssboTopLevel {
+    vec4 topLevelNodes[];   // min, max per node
+};
+layout(std430, binding = 12) buffer ssboInstances {
+    Instance instances[];
+};
+#endif
+
+// Specialized variants get these as #defines (see ShaderVariants) so the
+// loops over models, samples and bounces become constant and can unroll.
+#ifdef NUM_MODELS
+const int numModels = NUM_MODELS;
+#else
 uniform int numModels;
+#endif
+#ifdef SAMPLES
+const int samples = SAMPLES;
+#else
+uniform int samples;
+#endif
+#ifdef AA
+const int aa = AA;
+#else
+uniform int aa;
+#endif
+#ifdef BOUNCE_LIM
+const int bounceLim = BOUNCE_LIM;
+#else
+uniform int bounceLim;
+#endif
+
+// 0: shading, 1: triangle/AABB test heat map, with green where a traversal stack overflowed
+#ifndef DEBUG_MODE
+#define DEBUG_MODE 0
+#endif
+
 uniform vec3 cameraPos;
 uniform vec3 camForward;
 uniform vec3 camUp;
@@ -37,9 +156,6 @@ uniform vec3 camRight;
 uniform vec2 resolution;
 uniform int frameCount;
 uniform int numNodes;
-uniform int samples;
-uniform int aa;
-uniform int bounceLim;
 uniform sampler2D uPrevFrame;   // Previous accumulated result
 uniform uint time;
 
@@ -47,8 +163,15 @@ uniform vec3 skyColor;
 uniform vec3 sunDir;
 uniform vec3 sunColor;
 
-const int MAX_STACK_SIZE = 33;
+// enough for trees of up to 33 levels, ShaderVariants sizes it to deeper scenes
+#ifndef MAX_STACK_SIZE
+#define MAX_STACK_SIZE 33
+#endif
+#if STACKLESS == 0 || QUANTIZED_BVH == 1
 int stack[MAX_STACK_SIZE];
+#endif
+// pushes dropped because a stack was full, each one may have hidden a hit
+int stackOverflows = 0;
 
 float randomValue(inout uint state){
     state = state * 747796405u + 2891336453u;
@@ -87,10 +210,8 @@ vec3 randPointSphereN(inout uint state){
     return vec3(x, y, z);
 }
 
-bool rayTriangleIntersect(vec3 rayOrig, vec3 rayDir, vec3 v0, vec3 v1, vec3 v2, out float t, out float u, out float v){
+bool rayTriangleIntersect(vec3 rayOrig, vec3 rayDir, vec3 v0, vec3 edge1, vec3 edge2, out float t, out float u, out float v){
     const float EPSILON = 0.01;
-    vec3 edge1 = v1 - v0;
-    vec3 edge2 = v2 - v0;
 
     vec3 pvec = cross(rayDir, edge2);
     float det = dot(edge1, pvec);
@@ -158,6 +279,174 @@ float intersectAABB(vec3 rayOrigin, vec3 rayInvDir, vec3 boxMin, vec3 boxMax) {
     return didHit? tMin : 1000000000;
 }
 
+void intersectLeaf(int triStart, int numTris, vec3 rayPos, vec3 rayDir, inout float best_t, inout float best_u, inout float best_v, inout int triTest, inout int best_tri_i) {
+#if SPHERES == 1
+    // a sphere hit is stored as -2 - sphere so it can't be taken for a triangle or a miss
+    if (sphereLeaves) {
+        for (int j = triStart; j < triStart+numTris; j++){
+            triTest++;
+            vec4 sphere = spheres[j];
+            float t = sphereRayCollision(rayPos, rayDir, sphere.xyz, sphere.w);
+            if (t > 0 && t < best_t) {
+                best_t = t;
+                best_tri_i = -2 - j;
+            }
+        }
+        return;
+    }
+#endif
+    for (int j = triStart; j < triStart+numTris; j++){
+        float t = -1;
+        triTest++;
+        float u, v;
+#if TRIANGLE_DATA == 1
+        vec3 v1 = triangleData[j*3+0].xyz;
+        vec3 edge1 = triangleData[j*3+1].xyz;
+        vec3 edge2 = triangleData[j*3+2].xyz;
+#else
+        ivec4 tri = triangles[j];
+        vec3 v1 = vertices[tri.x].xyz;
+        vec3 edge1 = vertices[tri.y].xyz - v1;
+        vec3 edge2 = vertices[tri.z].xyz - v1;
+#endif
+        if (!rayTriangleIntersect(rayPos, rayDir, v1, edge1, edge2, t, u, v)) continue;
+        if (t < best_t) {
+            best_t = t;
+            best_tri_i = j;
+            best_u = u;
+            best_v = v;
+        }
+    }
+}
+
+#if STACKLESS == 1
+// the child of node the ray visits first, recomputed the same way on the way back up
+int nearChild(int node, vec3 rayDir) {
+    int a = int(boundingBoxMin[node].w);
+    int b = int(boundingBoxMax[node].w);
+    vec3 centerA = boundingBoxMin[a].xyz + boundingBoxMax[a].xyz;
+    vec3 centerB = boundingBoxMin[b].xyz + boundingBoxMax[b].xyz;
+    return dot(centerA - centerB, rayDir) <= 0 ? a : b;
+}
+
+int siblingOf(int node, int parent) {
+    int a = int(boundingBoxMin[parent].w);
+    return a == node ? int(boundingBoxMax[parent].w) : a;
+}
+
+// Same nodes and hits as the stack traversal, but the way back is read from
+// parentNodes, so nothing but the current node and the state is kept.
+void traverseBVH(int root, vec3 rayPos, vec3 rayDir, vec3 invRayDir, inout float best_t, inout float best_u, inout float best_v, inout int triTest, inout int aabbTest, inout int best_tri_i) {
+    if (boundingBoxMin[root].w <= 0) {
+        intersectLeaf(-int(boundingBoxMin[root].w), -int(boundingBoxMax[root].w), rayPos, rayDir, best_t, best_u, best_v, triTest, best_tri_i);
+        return;
+    }
+    const int FROM_PARENT = 0, FROM_SIBLING = 1, FROM_CHILD = 2;
+    int current = nearChild(root, rayDir);
+    int state = FROM_PARENT;
+
+    while (true) {
+        if (state == FROM_CHILD) {
+            if (current == root) return;
+            int parent = parentNodes[current];
+            if (current == nearChild(parent, rayDir)) {
+                current = siblingOf(current, parent);
+                state = FROM_SIBLING;
+            } else {
+                current = parent;
+            }
+            continue;
+        }
+
+        vec4 nodeMin = boundingBoxMin[current];
+        vec4 nodeMax = boundingBoxMax[current];
+        aabbTest++;
+        bool hit = intersectAABB(rayPos, invRayDir, nodeMin.xyz, nodeMax.xyz) < best_t;
+        if (hit && nodeMin.w > 0) {
+            current = nearChild(current, rayDir);
+            state = FROM_PARENT;
+            continue;
+        }
+        if (hit) intersectLeaf(-int(nodeMin.w), -int(nodeMax.w), rayPos, rayDir, best_t, best_u, best_v, triTest, best_tri_i);
+
+        // the near child goes on to its sibling, the far one back up
+        if (state == FROM_PARENT) {
+            current = siblingOf(current, parentNodes[current]);
+            state = FROM_SIBLING;
+        } else {
+            current = parentNodes[current];
+            state = FROM_CHILD;
+        }
+    }
+}
+#else
+#if PAGED == 1
+void intersectPageLeaf(int triStart, int numTris, vec3 rayPos, vec3 rayDir, inout float best_t, inout float best_u, inout float best_v, inout int triTest, inout int best_tri_i) {
+    for (int j = triStart; j < triStart+numTris; j++){
+        float t = -1;
+        triTest++;
+        float u, v;
+        int k = (j - PAGE_BASE) * 3;
+        if (!rayTriangleIntersect(rayPos, rayDir, pageTriangles[k].xyz, pageTriangles[k+1].xyz, pageTriangles[k+2].xyz, t, u, v)) continue;
+        if (t < best_t) {
+            best_t = t;
+            best_tri_i = j;
+            best_u = u;
+            best_v = v;
+        }
+    }
+}
+
+// Walks the page behind a link from its root, whose box the link shares and
+// the caller already tested. It has its own loop so neither it nor the
+// resident traversal picks a buffer per node, and uses the stack above
+// stackBase, which the caller's entries stay below.
+void traversePage(int page, int stackBase, vec3 rayPos, vec3 rayDir, vec3 invRayDir, inout float best_t, inout float best_u, inout float best_v, inout int triTest, inout int aabbTest, inout int best_tri_i) {
+    ivec2 entry = pageTable[page];
+    if (entry.y != pageFrame) pageTable[page].y = pageFrame;
+    if (entry.x < 0) {
+        pageMisses++;
+        return;
+    }
+    // node and triangle indices in a page are relative to its slot
+    int nodeBase = entry.x * PAGE_NODES * 2;
+    int triBase = PAGE_BASE + entry.x * PAGE_TRIANGLES;
+    int stackPtr = stackBase;
+    stack[stackPtr++] = 0;
+
+    while (stackPtr > stackBase) {
+        int nodeIndex = stack[--stackPtr];
+        vec4 nodeMin = pageNodes[nodeBase + nodeIndex * 2];
+        vec4 nodeMax = pageNodes[nodeBase + nodeIndex * 2 + 1];
+
+        if (nodeMin.w <= 0) {
+            intersectPageLeaf(triBase - int(nodeMin.w), -int(nodeMax.w), rayPos, rayDir, best_t, best_u, best_v, triTest, best_tri_i);
+            continue;
+        }
+        int childIndexA = int(nodeMin.w);
+        int childIndexB = int(nodeMax.w);
+        aabbTest += 2;
+        float disA = intersectAABB(rayPos, invRayDir, pageNodes[nodeBase + childIndexA * 2].xyz, pageNodes[nodeBase + childIndexA * 2 + 1].xyz);
+        float disB = intersectAABB(rayPos, invRayDir, pageNodes[nodeBase + childIndexB * 2].xyz, pageNodes[nodeBase + childIndexB * 2 + 1].xyz);
+
+        bool isNearestA = disA <= disB;
+        float disNear = isNearestA ? disA : disB;
+        float disFar = isNearestA ? disB : disA;
+        int childIndexNear = isNearestA ? childIndexA : childIndexB;
+        int childIndexFar = isNearestA ? childIndexB : childIndexA;
+
+        if (disFar < best_t) {
+            if (stackPtr < MAX_STACK_SIZE) stack[stackPtr++] = childIndexFar;
+            else stackOverflows++;
+        }
+        if (disNear < best_t) {
+            if (stackPtr < MAX_STACK_SIZE) stack[stackPtr++] = childIndexNear;
+            else stackOverflows++;
+        }
+    }
+}
+#endif
+
 void traverseBVH(int nodeOffset, vec3 rayPos, vec3 rayDir, vec3 invRayDir, inout float best_t, inout float best_u, inout float best_v, inout int triTest, inout int aabbTest, inout int best_tri_i) {
     int stackPtr = 0;
     stack[stackPtr++] = nodeOffset;  // start from root node  index=nodeOffset
@@ -168,25 +457,16 @@ void traverseBVH(int nodeOffset, vec3 rayPos, vec3 rayDir, vec3 invRayDir, inout
         vec4 bboxMax_childB = boundingBoxMax[nodeIndex];
 
         if (bboxMin_childA.w <= 0) {
+#if PAGED == 1
+            if (bboxMax_childB.w > 0) {
+                traversePage(-int(bboxMin_childA.w), stackPtr, rayPos, rayDir, invRayDir, best_t, best_u, best_v, triTest, aabbTest, best_tri_i);
+                continue;
+            }
+#endif
             // Intersect ray with all triangles in the leaf node
             int triStart = -int(bboxMin_childA.w);
             int numTris = -int(bboxMax_childB.w);
-            for (int j = triStart; j < triStart+numTris; j++){
-                float t = -1;
-                triTest++;
-                ivec4 tri = triangles[j];
-                vec4 v1 = vertices[tri.x];
-                vec4 v2 = vertices[tri.y];
-                vec4 v3 = vertices[tri.z];
-                float u, v;
-                if (!rayTriangleIntersect(rayPos, rayDir, v1.xyz, v2.xyz, v3.xyz, t, u, v)) continue;
-                if (t < best_t) {
-                    best_t = t;
-                    best_tri_i = j;
-                    best_u = u;
-                    best_v = v;
-                }
-            }
+            intersectLeaf(triStart, numTris, rayPos, rayDir, best_t, best_u, best_v, triTest, best_tri_i);
         }
         else {
             // Push children onto the stack
@@ -208,14 +488,106 @@ void traverseBVH(int nodeOffset, vec3 rayPos, vec3 rayDir, vec3 invRayDir, inout
             int childIndexNear = isNearestA ? childIndexA : childIndexB;
             int childIndexFar = isNearestA ? childIndexB : childIndexA;
 
-            if (disFar < best_t) stack[stackPtr++] = childIndexFar;
-            if (disNear < best_t) stack[stackPtr++] = childIndexNear;
+            if (disFar < best_t) {
+                if (stackPtr < MAX_STACK_SIZE) stack[stackPtr++] = childIndexFar;
+                else stackOverflows++;
+            }
+            if (disNear < best_t) {
+                if (stackPtr < MAX_STACK_SIZE) stack[stackPtr++] = childIndexNear;
+                else stackOverflows++;
+            }
+        }
+    }
+}
+#endif
+
+#if QUANTIZED_BVH == 1
+// origin + q * 2^e per axis, the same arithmetic the encoder checked for conservativeness
+void decodeChild(QuantizedNode node, uint lo, uint hi, out vec3 boxMin, out vec3 boxMax) {
+    const uvec3 shifts = uvec3(0, 8, 16);
+    vec3 origin = uintBitsToFloat(node.origin.xyz);
+    vec3 scale = uintBitsToFloat(((uvec3(node.origin.w) >> shifts) & 0xFFu) << 23);
+    boxMin = origin + vec3((uvec3(lo) >> shifts) & 0xFFu) * scale;
+    boxMax = origin + vec3((uvec3(hi) >> shifts) & 0xFFu) * scale;
+}
+
+void traverseQuantizedBVH(int root, vec3 rayPos, vec3 rayDir, vec3 invRayDir, inout float best_t, inout float best_u, inout float best_v, inout int triTest, inout int aabbTest, inout int best_tri_i) {
+    int stackPtr = 0;
+    stack[stackPtr++] = root;
 
-            // Prevent overflow (optional: clamp or discard)
-            if (stackPtr > MAX_STACK_SIZE) break;
+    while (stackPtr > 0) {
+        QuantizedNode node = quantizedNodes[stack[--stackPtr]];
+
+        vec3 minA, maxA, minB, maxB;
+        decodeChild(node, node.bounds.x, node.bounds.y, minA, maxA);
+        decodeChild(node, node.bounds.z, node.bounds.w, minB, maxB);
+        aabbTest += 2;
+        float disA = intersectAABB(rayPos, invRayDir, minA, maxA);
+        float disB = intersectAABB(rayPos, invRayDir, minB, maxB);
+
+        bool isNearestA = disA <= disB;
+        float disNear = isNearestA ? disA : disB;
+        float disFar = isNearestA ? disB : disA;
+        ivec2 near = isNearestA ? node.children.xy : node.children.zw;
+        ivec2 far = isNearestA ? node.children.zw : node.children.xy;
+
+        // leaf children are tested right away, nearest first, so the far test can use the new hit
+        if (disNear < best_t && near.y >= 0) intersectLeaf(near.x, near.y, rayPos, rayDir, best_t, best_u, best_v, triTest, best_tri_i);
+        if (disFar < best_t && far.y >= 0) intersectLeaf(far.x, far.y, rayPos, rayDir, best_t, best_u, best_v, triTest, best_tri_i);
+        if (disFar < best_t && far.y < 0) {
+            if (stackPtr < MAX_STACK_SIZE) stack[stackPtr++] = far.x;
+            else stackOverflows++;
+        }
+        if (disNear < best_t && near.y < 0) {
+            if (stackPtr < MAX_STACK_SIZE) stack[stackPtr++] = near.x;
+            else stackOverflows++;
         }
     }
 }
+#endif
+
+#if INSTANCES == 1
+const int TOP_LEVEL_STACK_SIZE = 32;
+
+// Walks the top-level BVH and traces every instance it reaches in model space.
+// The ray direction is not renormalized, so t stays comparable across instances.
+void traverseInstances(vec3 rayPos, vec3 rayDir, vec3 invRayDir, inout float best_t, inout float best_u, inout float best_v, inout int triTest, inout int aabbTest, inout int best_tri_i, inout int best_instance) {
+    int topStack[TOP_LEVEL_STACK_SIZE];
+    int stackPtr = 0;
+    topStack[stackPtr++] = 0;
+
+    while (stackPtr > 0) {
+        int nodeIndex = topStack[--stackPtr];
+        vec4 nodeMin = topLevelNodes[nodeIndex*2+0];
+        vec4 nodeMax = topLevelNodes[nodeIndex*2+1];
+        aabbTest++;
+        if (intersectAABB(rayPos, invRayDir, nodeMin.xyz, nodeMax.xyz) >= best_t) continue;
+
+        if (nodeMin.w <= 0) {
+            int first = -int(nodeMin.w);
+            int count = -int(nodeMax.w);
+            for (int j = first; j < first+count; j++) {
+                Instance instance = instances[j];
+                vec4 origin = vec4(rayPos, 1);
+                vec3 modelPos = vec3(dot(instance.worldToModel[0], origin), dot(instance.worldToModel[1], origin), dot(instance.worldToModel[2], origin));
+                vec3 modelDir = vec3(dot(instance.worldToModel[0].xyz, rayDir), dot(instance.worldToModel[1].xyz, rayDir), dot(instance.worldToModel[2].xyz, rayDir));
+                float before = best_t;
+#if QUANTIZED_BVH == 1
+                traverseQuantizedBVH(instance.info.y, modelPos, modelDir, 1/modelDir, best_t, best_u, best_v, triTest, aabbTest, best_tri_i);
+#else
+                traverseBVH(instance.info.x, modelPos, modelDir, 1/modelDir, best_t, best_u, best_v, triTest, aabbTest, best_tri_i);
+#endif
+                if (best_t < before) best_instance = j;
+            }
+        }
+        else if (stackPtr + 2 <= TOP_LEVEL_STACK_SIZE) {
+            topStack[stackPtr++] = int(nodeMax.w);
+            topStack[stackPtr++] = int(nodeMin.w);
+        }
+        else stackOverflows += 2;
+    }
+}
+#endif
 
 vec3 trace(vec3 pos, vec3 dir, inout uint state){
 
@@ -225,33 +597,92 @@ vec3 trace(vec3 pos, vec3 dir, inout uint state){
     for (int i = 0; i < bounceLim; i++) {
 
         float best_t = 1000000000;
-        int triTest, aabbTest;
+        int triTest = 0, aabbTest = 0;
         int best_tri_i = -1;
         float best_u, best_v, best_w;
+#if INSTANCES == 1
+        int best_instance = -1;
+        traverseInstances(pos, dir, invDir, best_t, best_u, best_v, triTest, aabbTest, best_tri_i, best_instance);
+#else
         for (int i = 0; i < numModels; i++){
+#if QUANTIZED_BVH == 1
+            traverseQuantizedBVH(quantizedModels[i], pos, dir, invDir, best_t, best_u, best_v, triTest, aabbTest, best_tri_i);
+#else
             traverseBVH(models[i], pos, dir, invDir, best_t, best_u, best_v, triTest, aabbTest, best_tri_i);
+#endif
         }
-
-        if (false){
-            int triThreshold = 50;
-            int aabbThreshold = 500;
-            color = vec3(float(triTest)/triThreshold, 0, float(aabbTest)/aabbThreshold);
-            if (triTest > triThreshold || aabbTest > aabbThreshold){
-                color = vec3(1);
-                return color;
-            }
+#endif
+#if SPHERES == 1
+        // in world space whether or not models are instanced
+        int best_material = -1;
+        sphereLeaves = true;
+        for (int i = 0; i < numSphereSets; i++){
+            ivec4 set = sphereSets[i];
+            float before = best_t;
+#if QUANTIZED_BVH == 1
+            traverseQuantizedBVH(set.y, pos, dir, invDir, best_t, best_u, best_v, triTest, aabbTest, best_tri_i);
+#else
+            traverseBVH(set.x, pos, dir, invDir, best_t, best_u, best_v, triTest, aabbTest, best_tri_i);
+#endif
+            if (best_t < before) best_material = set.z;
+        }
+        sphereLeaves = false;
+#endif
+
+#if DEBUG_MODE == 1
+        int triThreshold = 50;
+        int aabbThreshold = 500;
+        if (stackOverflows > 0) return vec3(0, 1, 0);
+#if PAGED == 1
+        if (pageMisses > 0) return vec3(1, 0, 1);
+#endif
+        color = vec3(float(triTest)/triThreshold, 0, float(aabbTest)/aabbThreshold);
+        if (triTest > triThreshold || aabbTest > aabbThreshold){
+            color = vec3(1);
             return color;
         }
+        return color;
+#endif
         best_w = 1-best_u-best_v;
 
         if (best_tri_i != -1) {
             pos += dir * best_t;
-            ivec4 tri = triangles[best_tri_i];
-            int material_i = tri.w;
-            vec3 v1 = vertices[tri.x].xyz;
-            vec3 v2 = vertices[tri.y].xyz;
-            vec3 v3 = vertices[tri.z].xyz;
-            vec3 normal = normalize(cross(v2 - v1, v3 - v1));
+            int material_i;
+            vec3 normal;
+#if SPHERES == 1
+            if (best_tri_i < -1) {
+                vec4 sphere = spheres[-2 - best_tri_i];
+                material_i = best_material;
+                normal = (pos - sphere.xyz) / sphere.w;
+            }
+            else
+#endif
+            {
+#if PAGED == 1
+                if (best_tri_i >= PAGE_BASE) {
+                    int k = (best_tri_i - PAGE_BASE) * 3;
+                    material_i = int(pageTriangles[k].w);
+                    normal = normalize(cross(pageTriangles[k+1].xyz, pageTriangles[k+2].xyz));
+                } else
+#endif
+                {
+                    ivec4 tri = triangles[best_tri_i];
+                    material_i = tri.w;
+#if TRIANGLE_DATA == 1
+                    normal = vec3(triangleData[best_tri_i*3+0].w, triangleData[best_tri_i*3+1].w, triangleData[best_tri_i*3+2].w);
+#else
+                    vec3 v1 = vertices[tri.x].xyz;
+                    vec3 v2 = vertices[tri.y].xyz;
+                    vec3 v3 = vertices[tri.z].xyz;
+                    normal = normalize(cross(v2 - v1, v3 - v1));
+#endif
+                }
+#if INSTANCES == 1
+                // model to world for normals is the transpose of world to model
+                vec4 rows[3] = instances[best_instance].worldToModel;
+                normal = normalize(normal.x * rows[0].xyz + normal.y * rows[1].xyz + normal.z * rows[2].xyz);
+#endif
+            }
 
             color *= colors[material_i].xyz;
             if (emission[material_i] > 0.0) {
@@ -0,0 +1,35 @@
+#version 430 core
+out vec4 FragColor;
+in vec2 fragCoord;
+// the traced frame, sampled with bilinear filtering and clamped edges
+uniform sampler2D screenTex;
+
+// Catmull-Rom upscale for dynamic resolution (see ResolutionScaler.h). The
+// 4x4 kernel is separable, so the two middle taps per axis merge into one
+// bilinear fetch; the four corners carry the least weight and are dropped,
+// leaving 5 fetches, renormalized for the dropped weight.
+void main() {
+    vec2 size = vec2(textureSize(screenTex, 0));
+    vec2 samplePos = fragCoord * size;
+    vec2 texPos1 = floor(samplePos - 0.5) + 0.5;
+    vec2 f = samplePos - texPos1;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    vec2 w12 = w1 + w2;
+
+    vec2 texPos0 = (texPos1 - 1.0) / size;
+    vec2 texPos3 = (texPos1 + 2.0) / size;
+    vec2 texPos12 = (texPos1 + w2 / w12) / size;
+
+    vec4 color = texture(screenTex, vec2(texPos12.x, texPos0.y)) * w12.x * w0.y
+               + texture(screenTex, vec2(texPos0.x, texPos12.y)) * w0.x * w12.y
+               + texture(screenTex, texPos12) * w12.x * w12.y
+               + texture(screenTex, vec2(texPos3.x, texPos12.y)) * w3.x * w12.y
+               + texture(screenTex, vec2(texPos12.x, texPos3.y)) * w12.x * w3.y;
+    float weight = w12.x * w0.y + w0.x * w12.y + w12.x * w12.y + w3.x * w12.y + w12.x * w3.y;
+    // the negative lobes can overshoot below zero next to hard edges
+    FragColor = vec4(max(color.rgb / weight, 0.0), 1.0);
+}